@@ -0,0 +1,214 @@
+// bench_filter.c
+// Filter + score microbenchmark: times the scalar, SSE2 and AVX2 paths of
+// filter_score_range() and the query engine's plan (posting list when
+// selective) on a dataset replicated in memory, and checks every path
+// returns the same rows and scores as the scalar one.
+// Build: gcc -O2 bench_filter.c filter_kernel.c package_index.c package_store.c query_engine.c string_dict.c topk.c -o bench_filter -lm -pthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "package_store.h"
+#include "filter_kernel.h"
+#include "package_index.h"
+#include "query_engine.h"
+
+#define REPEATS 5
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Append copies - 1 more copies of every row (string views share the text)
+int replicate_rows(PackageStore* s, int copies) {
+    int n = s->count;
+    if (copies < 2 || n == 0) return 0;
+    if (store_reserve(s, n * copies) != 0) return -1;
+
+    for (int c = 1; c < copies; c++) {
+        int base = c * n;
+        memcpy(s->package_ids + base, s->package_ids, n * sizeof(StrRef));
+        memcpy(s->place_names + base, s->place_names, n * sizeof(StrRef));
+        memcpy(s->province_codes + base, s->province_codes, n);
+        memcpy(s->category_codes + base, s->category_codes, n);
+        memcpy(s->duration_days + base, s->duration_days, n * sizeof(int));
+        memcpy(s->avg_prices + base, s->avg_prices, n * sizeof(double));
+        memcpy(s->ratings + base, s->ratings, n * sizeof(double));
+        memcpy(s->reviews_counts + base, s->reviews_counts, n * sizeof(int));
+        memcpy(s->popularity_scores + base, s->popularity_scores, n * sizeof(double));
+        memcpy(s->base_scores + base, s->base_scores, n * sizeof(double));
+    }
+    s->count = n * copies;
+    return 0;
+}
+
+// Order (row, score) pairs by row: windows of the sorted price/rating
+// columns produce matches in value order
+typedef struct {
+    int row;
+    double score;
+} Match;
+
+int compare_match(const void* a, const void* b) {
+    int ra = ((const Match*)a)->row;
+    int rb = ((const Match*)b)->row;
+    return (ra > rb) - (ra < rb);
+}
+
+int sort_by_row(int* rows, double* scores, int count) {
+    Match* m = (Match*)malloc((count > 0 ? count : 1) * sizeof(Match));
+    if (m == NULL) return -1;
+    for (int i = 0; i < count; i++) {
+        m[i].row = rows[i];
+        m[i].score = scores[i];
+    }
+    qsort(m, count, sizeof(Match), compare_match);
+    for (int i = 0; i < count; i++) {
+        rows[i] = m[i].row;
+        scores[i] = m[i].score;
+    }
+    free(m);
+    return 0;
+}
+
+// Queries covering broad scans, dictionary filters and range filters
+typedef struct {
+    const char* label;
+    const char* province;
+    const char* category;
+    double budget_min;
+    double budget_max;
+    int days;
+    double min_rating;
+} BenchQuery;
+
+static const BenchQuery queries[] = {
+    { "TOPK=5 (no filter)",      "",       "",       0.0,     1000000.0, -1, 0.0 },
+    { "PROVINCE=Punjab",         "Punjab", "",       0.0,     1000000.0, -1, 0.0 },
+    { "PROVINCE+CATEGORY",       "Punjab", "Nature", 0.0,     1000000.0, -1, 0.0 },
+    { "BUDGET 10000-40000",      "",       "",       10000.0, 40000.0,   -1, 0.0 },
+    { "BUDGET 10000-12000",      "",       "",       10000.0, 12000.0,   -1, 0.0 },
+    { "BUDGET 10000-10200",      "",       "",       10000.0, 10200.0,   -1, 0.0 },
+    { "MIN_RATING=4.8",          "",       "",       0.0,     1000000.0, -1, 4.8 },
+    { "DAYS=3;MIN_RATING=4.0",   "",       "",       0.0,     1000000.0,  3, 4.0 },
+    { "All predicates",          "Punjab", "Nature", 5000.0,  30000.0,    7, 3.5 },
+};
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <dataset_file> [copies]\n", argv[0]);
+        printf("Example: %s package_dataset_pakistan.txt 2000\n", argv[0]);
+        return 1;
+    }
+
+    int copies = (argc >= 3) ? atoi(argv[2]) : 1000;
+    if (copies < 1) copies = 1;
+
+    PackageStore store;
+    store_init(&store);
+    if (store_load_tsv(&store, argv[1]) != 0) {
+        printf("Error: Cannot open file %s\n", argv[1]);
+        return 1;
+    }
+    if (replicate_rows(&store, copies) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
+
+    int n = store.count;
+    PackageIndex index;
+    if (index_build(&index, &store) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
+
+    int* ref_rows = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    double* ref_scores = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    int* rows = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    double* scores = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (ref_rows == NULL || ref_scores == NULL || rows == NULL || scores == NULL) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
+
+    FilterIsa best = filter_best_isa();
+    printf("Rows: %d, best path on this CPU: %s (best of %d runs)\n\n",
+           n, filter_isa_name(best), REPEATS);
+    printf("%-22s | %9s | %-6s | %9s | %8s | %7s\n",
+           "Query", "Matches", "Path", "Time (ms)", "Mrows/s", "Speedup");
+    printf("-----------------------+-----------+--------+-----------+----------+--------\n");
+
+    int num_queries = (int)(sizeof(queries) / sizeof(queries[0]));
+    for (int qi = 0; qi < num_queries; qi++) {
+        const BenchQuery* bq = &queries[qi];
+        Query q;
+        q.province_code = dict_query_code(&store.province_dict, bq->province);
+        q.category_code = dict_query_code(&store.category_dict, bq->category);
+        q.budget_min = bq->budget_min;
+        q.budget_max = bq->budget_max;
+        q.days = bq->days;
+        q.min_rating = bq->min_rating;
+        q.topk = 5;
+
+        double scalar_time = 0.0;
+        int ref_count = 0;
+        // One pass per kernel path, then one through the engine's plan
+        for (int path = FILTER_ISA_SCALAR; path <= (int)best + 1; path++) {
+            int use_engine = (path > (int)best);
+            FilterIsa isa = use_engine ? best : (FilterIsa)path;
+            if (filter_set_isa(isa) != 0) continue;
+
+            QueryPlan plan;
+            engine_plan(&index, &q, 0, n, &plan);
+
+            double fastest = -1.0;
+            int count = 0;
+            for (int r = 0; r < REPEATS; r++) {
+                double t0 = now_seconds();
+                if (use_engine) {
+                    engine_plan(&index, &q, 0, n, &plan);
+                    count = engine_eval(&store, &q, &plan, 0, plan.length, rows, scores);
+                } else {
+                    count = filter_score_range(&store, &q, 0, n, rows, scores);
+                }
+                double t1 = now_seconds();
+                if (fastest < 0.0 || t1 - t0 < fastest) fastest = t1 - t0;
+            }
+
+            const char* path_name = filter_isa_name(isa);
+            if (use_engine) path_name = (plan.candidates != NULL) ? "index" : "engine";
+            if (use_engine && sort_by_row(rows, scores, count) != 0) {
+                printf("Error: Out of memory\n");
+                return 1;
+            }
+
+            if (path == FILTER_ISA_SCALAR) {
+                scalar_time = fastest;
+                ref_count = count;
+                memcpy(ref_rows, rows, count * sizeof(int));
+                memcpy(ref_scores, scores, count * sizeof(double));
+            } else if (count != ref_count ||
+                       memcmp(ref_rows, rows, count * sizeof(int)) != 0 ||
+                       memcmp(ref_scores, scores, count * sizeof(double)) != 0) {
+                printf("Error: %s path disagrees with scalar on \"%s\"\n",
+                       path_name, bq->label);
+                return 1;
+            }
+
+            printf("%-22s | %9d | %-6s | %9.3f | %8.1f | %6.2fx\n",
+                   path == FILTER_ISA_SCALAR ? bq->label : "", count, path_name,
+                   fastest * 1000.0, n / fastest / 1e6, scalar_time / fastest);
+        }
+    }
+
+    free(ref_rows);
+    free(ref_scores);
+    free(rows);
+    free(scores);
+    index_free(&index);
+    store_free(&store);
+    return 0;
+}
@@ -0,0 +1,130 @@
+// bench_load.c
+// Dataset load-time scaling: enlarges a dataset by repeating its rows, then
+// times store_load_tsv_parallel() with 1, 2, 4, ... threads.
+// Build: gcc -O2 bench_load.c package_store.c string_dict.c -o bench_load -lm -pthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "package_store.h"
+
+#define REPEATS 3
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Write header + `copies` copies of the dataset rows to out_path
+int write_enlarged(const char* src_path, const char* out_path, int copies) {
+    FILE* in = fopen(src_path, "r");
+    if (in == NULL) return -1;
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    char* data = (char*)malloc(size + 1);
+    if (data == NULL || fread(data, 1, size, in) != (size_t)size) {
+        fclose(in);
+        free(data);
+        return -1;
+    }
+    fclose(in);
+    if (size > 0 && data[size - 1] != '\n') data[size++] = '\n';
+
+    // Rows start after the header line
+    char* rows = memchr(data, '\n', size);
+    rows = (rows != NULL) ? rows + 1 : data + size;
+
+    FILE* out = fopen(out_path, "w");
+    if (out == NULL) {
+        free(data);
+        return -1;
+    }
+    fwrite(data, 1, rows - data, out);
+    for (int c = 0; c < copies; c++) {
+        fwrite(rows, 1, data + size - rows, out);
+    }
+    fclose(out);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <dataset_file> [copies] [max_threads]\n", argv[0]);
+        printf("Example: %s package_dataset_pakistan.txt 2000 8\n", argv[0]);
+        return 1;
+    }
+
+    int copies = (argc >= 3) ? atoi(argv[2]) : 1000;
+    int max_threads = (argc >= 4) ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (copies < 1) copies = 1;
+    if (max_threads < 1) max_threads = 1;
+
+    char path[] = "/tmp/wanderhub_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+
+    printf("Writing %d copies of %s to %s...\n", copies, argv[1], path);
+    if (write_enlarged(argv[1], path, copies) != 0) {
+        printf("Error: Cannot enlarge dataset %s\n", argv[1]);
+        unlink(path);
+        return 1;
+    }
+
+    // Warm the page cache so every run measures parsing, not disk reads
+    PackageStore warm;
+    store_init(&warm);
+    if (store_load_tsv(&warm, path) != 0) {
+        printf("Error: Cannot load %s\n", path);
+        unlink(path);
+        return 1;
+    }
+    int expected_rows = warm.count;
+    store_free(&warm);
+
+    printf("Rows: %d (best of %d runs)\n\n", expected_rows, REPEATS);
+    printf("Threads | Load time (s) | Rows/s       | Speedup\n");
+    printf("--------+---------------+--------------+--------\n");
+
+    double base_time = 0.0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        double best = -1.0;
+        for (int r = 0; r < REPEATS; r++) {
+            PackageStore store;
+            store_init(&store);
+
+            double t0 = now_seconds();
+            int rc = store_load_tsv_parallel(&store, path, threads);
+            double t1 = now_seconds();
+
+            if (rc != 0 || store.count != expected_rows) {
+                printf("Error: load with %d threads returned %d rows\n", threads, store.count);
+                store_free(&store);
+                unlink(path);
+                return 1;
+            }
+            store_free(&store);
+
+            if (best < 0.0 || t1 - t0 < best) best = t1 - t0;
+        }
+
+        if (threads == 1) base_time = best;
+        printf("%7d | %13.4f | %12.0f | %6.2fx\n",
+               threads, best, expected_rows / best, base_time / best);
+
+        if (threads < max_threads && threads * 2 > max_threads) threads = max_threads / 2;
+    }
+
+    unlink(path);
+    return 0;
+}
@@ -0,0 +1,158 @@
+// check_scores.c
+// Score regression check: loads a dataset through the serial and parallel
+// TSV parsers and through a snapshot, and checks that every row's score
+// (base_scores plus the closeness terms, on every filter path the CPU
+// supports) is bit-identical to the original inline formula.
+// Build: gcc -O2 check_scores.c filter_kernel.c package_store.c query.c snapshot.c string_dict.c -o check_scores -lm -pthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include "package_store.h"
+#include "snapshot.h"
+#include "query.h"
+#include "filter_kernel.h"
+
+#define PARALLEL_THREADS 4
+
+// Closeness settings to score under: none, budget only, days only, both
+typedef struct {
+    double budget_max;
+    int days;
+} ScoreCase;
+
+static const ScoreCase cases[] = {
+    { QUERY_NO_BUDGET_MAX, -1 },
+    { 20000.0, -1 },
+    { QUERY_NO_BUDGET_MAX, 3 },
+    { 15000.0, 5 },
+};
+
+// The score as every program computed it before base_scores existed:
+// 50*rating + 10*popularity_score + 5*log(reviews_count+1) + budget_closeness + duration_closeness
+double reference_score(const PackageStore* s, const Query* q, int row) {
+    double score = 0.0;
+    score += 50.0 * s->ratings[row];
+    score += 10.0 * s->popularity_scores[row];
+    score += 5.0 * log(s->reviews_counts[row] + 1.0);
+
+    if (q->budget_max < QUERY_NO_BUDGET_MAX) {
+        double budget_diff = fabs(s->avg_prices[row] - q->budget_max);
+        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
+        score += budget_closeness;
+    }
+
+    if (q->days > 0) {
+        int duration_diff = abs(s->duration_days[row] - q->days);
+        double duration_closeness = 50.0 / (1.0 + duration_diff);
+        score += duration_closeness;
+    }
+
+    return score;
+}
+
+// Check every row of s under every case. Returns the number of mismatches.
+int check_store(const PackageStore* s, const char* label) {
+    int n = s->count;
+    int* rows = (int*)malloc((n > 0 ? n : 1) * sizeof(int));
+    double* scores = (double*)malloc((n > 0 ? n : 1) * sizeof(double));
+    if (rows == NULL || scores == NULL) {
+        printf("Error: Out of memory\n");
+        free(rows);
+        free(scores);
+        return 1;
+    }
+
+    int mismatches = 0;
+    int num_cases = (int)(sizeof(cases) / sizeof(cases[0]));
+    for (int c = 0; c < num_cases; c++) {
+        Query q;
+        query_defaults(&q);
+        q.budget_max = cases[c].budget_max;
+        q.days = cases[c].days;
+
+        for (int row = 0; row < n; row++) {
+            if (s->base_scores[row] != store_base_score(s->ratings[row], s->popularity_scores[row],
+                                                        s->reviews_counts[row]) ||
+                filter_row_score(s, &q, row) != reference_score(s, &q, row)) {
+                if (mismatches++ < 5) {
+                    printf("Error: %s: row %d scores %.17g, expected %.17g (budget_max %.0f, days %d)\n",
+                           label, row, filter_row_score(s, &q, row), reference_score(s, &q, row),
+                           q.budget_max, q.days);
+                }
+            }
+        }
+
+        // The vector paths compute their scores themselves
+        for (int isa = FILTER_ISA_SCALAR; isa <= (int)filter_best_isa(); isa++) {
+            if (filter_set_isa((FilterIsa)isa) != 0) continue;
+            int count = filter_score_range(s, &q, 0, n, rows, scores);
+            for (int i = 0; i < count; i++) {
+                if (scores[i] != reference_score(s, &q, rows[i]) && mismatches++ < 5) {
+                    printf("Error: %s: row %d scores %.17g on the %s path, expected %.17g\n",
+                           label, rows[i], scores[i], filter_isa_name((FilterIsa)isa),
+                           reference_score(s, &q, rows[i]));
+                }
+            }
+        }
+        filter_set_isa(filter_best_isa());
+    }
+
+    printf("%-22s | %7d rows | %s\n", label, n, mismatches == 0 ? "ok" : "MISMATCH");
+    free(rows);
+    free(scores);
+    return mismatches;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <dataset_file>\n", argv[0]);
+        printf("Example: %s package_dataset_pakistan.txt\n", argv[0]);
+        return 1;
+    }
+
+    PackageStore serial;
+    PackageStore parallel;
+    PackageStore snap;
+    store_init(&serial);
+    store_init(&parallel);
+    store_init(&snap);
+    if (store_load_tsv(&serial, argv[1]) != 0 ||
+        store_load_tsv_parallel(&parallel, argv[1], PARALLEL_THREADS) != 0) {
+        printf("Error: Cannot open file %s\n", argv[1]);
+        return 1;
+    }
+
+    // Snapshot written from the parsed store and mapped back
+    char path[] = "/tmp/wanderhub_scores_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    if (snapshot_write(&serial, argv[1], path) != 0 || snapshot_open(&snap, argv[1], path) != 0) {
+        printf("Error: Cannot write and reopen a snapshot of %s\n", argv[1]);
+        unlink(path);
+        return 1;
+    }
+
+    int mismatches = 0;
+    mismatches += check_store(&serial, "TSV");
+    mismatches += check_store(&parallel, "TSV, parallel");
+    mismatches += check_store(&snap, "snapshot");
+
+    store_free(&serial);
+    store_free(&parallel);
+    store_free(&snap);
+    unlink(path);
+
+    if (mismatches > 0) {
+        printf("\n%d scores differ from the original formula\n", mismatches);
+        return 1;
+    }
+    printf("\nAll scores match the original formula.\n");
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include "filter_kernel.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define FILTER_HAVE_X86 1
+#endif
+
+typedef int (*RangeKernel)(const PackageStore*, const Query*, int, int, int*, double*);
+
+int filter_row_matches(const PackageStore* s, const Query* q, int row) {
+    if (q->province_code != DICT_ANY && s->province_codes[row] != q->province_code) return 0;
+    if (q->category_code != DICT_ANY && s->category_codes[row] != q->category_code) return 0;
+    if (s->avg_prices[row] < q->budget_min || s->avg_prices[row] > q->budget_max) return 0;
+    if (q->days > 0 && s->duration_days[row] != q->days) return 0;
+    if (s->ratings[row] < q->min_rating) return 0;
+    return 1;
+}
+
+double filter_row_score(const PackageStore* s, const Query* q, int row) {
+    double score = s->base_scores[row];  // rating, popularity and reviews terms
+
+    // Budget closeness (only if budget max is changed by user)
+    if (q->budget_max < QUERY_NO_BUDGET_MAX) {
+        double budget_diff = fabs(s->avg_prices[row] - q->budget_max);
+        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
+        score += budget_closeness;
+    }
+
+    // Duration closeness (only if days filter used)
+    if (q->days > 0) {
+        int duration_diff = abs(s->duration_days[row] - q->days);
+        double duration_closeness = 50.0 / (1.0 + duration_diff);
+        score += duration_closeness;
+    }
+
+    return score;
+}
+
+static int range_scalar(const PackageStore* s, const Query* q, int begin, int end,
+                        int* rows, double* scores) {
+    int n = 0;
+    for (int i = begin; i < end; i++) {
+        if (filter_row_matches(s, q, i)) {
+            rows[n] = i;
+            scores[n] = filter_row_score(s, q, i);
+            n++;
+        }
+    }
+    return n;
+}
+
+#ifdef FILTER_HAVE_X86
+
+// Append the rows of a block selected by mask, with their scores
+static inline int emit_selected(unsigned mask, int first_row, const double* block_scores,
+                                int* rows, double* scores, int n) {
+    while (mask != 0) {
+        int lane = __builtin_ctz(mask);
+        rows[n] = first_row + lane;
+        scores[n] = block_scores[lane];
+        n++;
+        mask &= mask - 1;
+    }
+    return n;
+}
+
+// The comparisons below are negated (NLT/NGT, unordered-true) so a NaN
+// price or rating passes exactly when it passes filter_row_matches().
+
+__attribute__((target("sse2")))
+static int range_sse2(const PackageStore* s, const Query* q, int begin, int end,
+                      int* rows, double* scores) {
+    const __m128d budget_min = _mm_set1_pd(q->budget_min);
+    const __m128d budget_max = _mm_set1_pd(q->budget_max);
+    const __m128d min_rating = _mm_set1_pd(q->min_rating);
+    const __m128d sign_bit = _mm_set1_pd(-0.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    const __m128d thousand = _mm_set1_pd(1000.0);
+    const __m128d hundred = _mm_set1_pd(100.0);
+    const __m128d fifty = _mm_set1_pd(50.0);
+    const __m128i days = _mm_set1_epi32(q->days);
+    const __m128i province = _mm_set1_epi8((char)q->province_code);
+    const __m128i category = _mm_set1_epi8((char)q->category_code);
+    const int use_budget = q->budget_max < QUERY_NO_BUDGET_MAX;
+    const int use_days = q->days > 0;
+
+    int n = 0;
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        unsigned mask = 0xF;
+        int codes;
+        if (q->province_code != DICT_ANY) {
+            memcpy(&codes, s->province_codes + i, 4);
+            mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(codes), province));
+        }
+        if (q->category_code != DICT_ANY) {
+            memcpy(&codes, s->category_codes + i, 4);
+            mask &= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(codes), category));
+        }
+        if (mask == 0) continue;
+
+        __m128d p0 = _mm_loadu_pd(s->avg_prices + i);
+        __m128d p1 = _mm_loadu_pd(s->avg_prices + i + 2);
+        __m128d in0 = _mm_and_pd(_mm_cmpnlt_pd(p0, budget_min), _mm_cmpngt_pd(p0, budget_max));
+        __m128d in1 = _mm_and_pd(_mm_cmpnlt_pd(p1, budget_min), _mm_cmpngt_pd(p1, budget_max));
+        mask &= (unsigned)(_mm_movemask_pd(in0) | (_mm_movemask_pd(in1) << 2));
+
+        __m128d r0 = _mm_cmpnlt_pd(_mm_loadu_pd(s->ratings + i), min_rating);
+        __m128d r1 = _mm_cmpnlt_pd(_mm_loadu_pd(s->ratings + i + 2), min_rating);
+        mask &= (unsigned)(_mm_movemask_pd(r0) | (_mm_movemask_pd(r1) << 2));
+
+        __m128i d = _mm_setzero_si128();
+        if (use_days) {
+            d = _mm_loadu_si128((const __m128i*)(s->duration_days + i));
+            mask &= (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(d, days)));
+        }
+        if (mask == 0) continue;
+
+        // Scores for the block, added in filter_row_score() order
+        __m128d sc0 = _mm_loadu_pd(s->base_scores + i);
+        __m128d sc1 = _mm_loadu_pd(s->base_scores + i + 2);
+        if (use_budget) {
+            __m128d diff0 = _mm_andnot_pd(sign_bit, _mm_sub_pd(p0, budget_max));
+            __m128d diff1 = _mm_andnot_pd(sign_bit, _mm_sub_pd(p1, budget_max));
+            sc0 = _mm_add_pd(sc0, _mm_div_pd(hundred, _mm_add_pd(one, _mm_div_pd(diff0, thousand))));
+            sc1 = _mm_add_pd(sc1, _mm_div_pd(hundred, _mm_add_pd(one, _mm_div_pd(diff1, thousand))));
+        }
+        if (use_days) {
+            __m128i diff = _mm_sub_epi32(d, days);
+            __m128i sign = _mm_srai_epi32(diff, 31);
+            diff = _mm_sub_epi32(_mm_xor_si128(diff, sign), sign);
+            __m128d diff0 = _mm_cvtepi32_pd(diff);
+            __m128d diff1 = _mm_cvtepi32_pd(_mm_shuffle_epi32(diff, _MM_SHUFFLE(1, 0, 3, 2)));
+            sc0 = _mm_add_pd(sc0, _mm_div_pd(fifty, _mm_add_pd(one, diff0)));
+            sc1 = _mm_add_pd(sc1, _mm_div_pd(fifty, _mm_add_pd(one, diff1)));
+        }
+
+        double block[4];
+        _mm_storeu_pd(block, sc0);
+        _mm_storeu_pd(block + 2, sc1);
+        n = emit_selected(mask, i, block, rows, scores, n);
+    }
+
+    return n + range_scalar(s, q, i, end, rows + n, scores + n);
+}
+
+__attribute__((target("avx2")))
+static int range_avx2(const PackageStore* s, const Query* q, int begin, int end,
+                      int* rows, double* scores) {
+    const __m256d budget_min = _mm256_set1_pd(q->budget_min);
+    const __m256d budget_max = _mm256_set1_pd(q->budget_max);
+    const __m256d min_rating = _mm256_set1_pd(q->min_rating);
+    const __m256d sign_bit = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d thousand = _mm256_set1_pd(1000.0);
+    const __m256d hundred = _mm256_set1_pd(100.0);
+    const __m256d fifty = _mm256_set1_pd(50.0);
+    const __m256i days = _mm256_set1_epi32(q->days);
+    const __m128i province = _mm_set1_epi8((char)q->province_code);
+    const __m128i category = _mm_set1_epi8((char)q->category_code);
+    const int use_budget = q->budget_max < QUERY_NO_BUDGET_MAX;
+    const int use_days = q->days > 0;
+
+    int n = 0;
+    int i = begin;
+    for (; i + 8 <= end; i += 8) {
+        unsigned mask = 0xFF;
+        if (q->province_code != DICT_ANY) {
+            __m128i codes = _mm_loadl_epi64((const __m128i*)(s->province_codes + i));
+            mask &= (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(codes, province));
+        }
+        if (q->category_code != DICT_ANY) {
+            __m128i codes = _mm_loadl_epi64((const __m128i*)(s->category_codes + i));
+            mask &= (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(codes, category));
+        }
+        if (mask == 0) continue;
+
+        __m256d p0 = _mm256_loadu_pd(s->avg_prices + i);
+        __m256d p1 = _mm256_loadu_pd(s->avg_prices + i + 4);
+        __m256d in0 = _mm256_and_pd(_mm256_cmp_pd(p0, budget_min, _CMP_NLT_UQ),
+                                    _mm256_cmp_pd(p0, budget_max, _CMP_NGT_UQ));
+        __m256d in1 = _mm256_and_pd(_mm256_cmp_pd(p1, budget_min, _CMP_NLT_UQ),
+                                    _mm256_cmp_pd(p1, budget_max, _CMP_NGT_UQ));
+        mask &= (unsigned)(_mm256_movemask_pd(in0) | (_mm256_movemask_pd(in1) << 4));
+
+        __m256d r0 = _mm256_cmp_pd(_mm256_loadu_pd(s->ratings + i), min_rating, _CMP_NLT_UQ);
+        __m256d r1 = _mm256_cmp_pd(_mm256_loadu_pd(s->ratings + i + 4), min_rating, _CMP_NLT_UQ);
+        mask &= (unsigned)(_mm256_movemask_pd(r0) | (_mm256_movemask_pd(r1) << 4));
+
+        __m256i d = _mm256_setzero_si256();
+        if (use_days) {
+            d = _mm256_loadu_si256((const __m256i*)(s->duration_days + i));
+            mask &= (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(d, days)));
+        }
+        if (mask == 0) continue;
+
+        // Scores for the block, added in filter_row_score() order
+        __m256d sc0 = _mm256_loadu_pd(s->base_scores + i);
+        __m256d sc1 = _mm256_loadu_pd(s->base_scores + i + 4);
+        if (use_budget) {
+            __m256d diff0 = _mm256_andnot_pd(sign_bit, _mm256_sub_pd(p0, budget_max));
+            __m256d diff1 = _mm256_andnot_pd(sign_bit, _mm256_sub_pd(p1, budget_max));
+            sc0 = _mm256_add_pd(sc0, _mm256_div_pd(hundred, _mm256_add_pd(one, _mm256_div_pd(diff0, thousand))));
+            sc1 = _mm256_add_pd(sc1, _mm256_div_pd(hundred, _mm256_add_pd(one, _mm256_div_pd(diff1, thousand))));
+        }
+        if (use_days) {
+            __m256i diff = _mm256_abs_epi32(_mm256_sub_epi32(d, days));
+            __m256d diff0 = _mm256_cvtepi32_pd(_mm256_castsi256_si128(diff));
+            __m256d diff1 = _mm256_cvtepi32_pd(_mm256_extracti128_si256(diff, 1));
+            sc0 = _mm256_add_pd(sc0, _mm256_div_pd(fifty, _mm256_add_pd(one, diff0)));
+            sc1 = _mm256_add_pd(sc1, _mm256_div_pd(fifty, _mm256_add_pd(one, diff1)));
+        }
+
+        double block[8];
+        _mm256_storeu_pd(block, sc0);
+        _mm256_storeu_pd(block + 4, sc1);
+        n = emit_selected(mask, i, block, rows, scores, n);
+    }
+
+    return n + range_scalar(s, q, i, end, rows + n, scores + n);
+}
+
+#endif
+
+// ---------------- Runtime dispatch ----------------
+static pthread_once_t dispatch_once = PTHREAD_ONCE_INIT;
+static FilterIsa active_isa = FILTER_ISA_SCALAR;
+static RangeKernel active_kernel = range_scalar;
+
+static int isa_supported(FilterIsa isa) {
+    if (isa == FILTER_ISA_SCALAR) return 1;
+#ifdef FILTER_HAVE_X86
+    __builtin_cpu_init();
+    if (isa == FILTER_ISA_SSE2) return __builtin_cpu_supports("sse2");
+    if (isa == FILTER_ISA_AVX2) return __builtin_cpu_supports("avx2");
+#endif
+    return 0;
+}
+
+static RangeKernel kernel_for(FilterIsa isa) {
+#ifdef FILTER_HAVE_X86
+    if (isa == FILTER_ISA_AVX2) return range_avx2;
+    if (isa == FILTER_ISA_SSE2) return range_sse2;
+#endif
+    return range_scalar;
+}
+
+FilterIsa filter_best_isa(void) {
+    if (isa_supported(FILTER_ISA_AVX2)) return FILTER_ISA_AVX2;
+    if (isa_supported(FILTER_ISA_SSE2)) return FILTER_ISA_SSE2;
+    return FILTER_ISA_SCALAR;
+}
+
+static void pick_best_isa(void) {
+    active_isa = filter_best_isa();
+    active_kernel = kernel_for(active_isa);
+}
+
+FilterIsa filter_active_isa(void) {
+    pthread_once(&dispatch_once, pick_best_isa);
+    return active_isa;
+}
+
+const char* filter_isa_name(FilterIsa isa) {
+    if (isa == FILTER_ISA_AVX2) return "avx2";
+    if (isa == FILTER_ISA_SSE2) return "sse2";
+    return "scalar";
+}
+
+int filter_set_isa(FilterIsa isa) {
+    pthread_once(&dispatch_once, pick_best_isa);
+    if (!isa_supported(isa)) return -1;
+    active_isa = isa;
+    active_kernel = kernel_for(isa);
+    return 0;
+}
+
+int filter_score_range(const PackageStore* s, const Query* q, int begin, int end,
+                       int* rows, double* scores) {
+    pthread_once(&dispatch_once, pick_best_isa);
+    return active_kernel(s, q, begin, end, rows, scores);
+}
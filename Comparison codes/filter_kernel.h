@@ -0,0 +1,41 @@
+#ifndef FILTER_KERNEL_H
+#define FILTER_KERNEL_H
+
+#include "package_store.h"
+#include "query.h"
+
+// Filter + score kernel shared by all recommenders.
+//
+// A row matches when its province/category codes, price range, duration and
+// rating pass the query, and scores base_scores[row] plus the budget and
+// duration closeness terms. The vector paths test 4 (SSE2) or 8 (AVX2) rows
+// at a time into a selection bitmask and only compute scores for blocks
+// with a selected row. They produce exactly the rows and scores of the
+// scalar path. The best path the CPU supports is picked on first use.
+
+#define FILTER_TILE_ROWS 256   // rows per batch for callers with stack buffers
+
+typedef enum {
+    FILTER_ISA_SCALAR,
+    FILTER_ISA_SSE2,
+    FILTER_ISA_AVX2
+} FilterIsa;
+
+FilterIsa filter_best_isa(void);   // best path this CPU supports
+FilterIsa filter_active_isa(void);
+const char* filter_isa_name(FilterIsa isa);
+
+// Force a path (benchmarks). -1 if the CPU does not support it.
+int filter_set_isa(FilterIsa isa);
+
+// One row at a time (reference semantics)
+int filter_row_matches(const PackageStore* s, const Query* q, int row);
+double filter_row_score(const PackageStore* s, const Query* q, int row);
+
+// Write the index and score of every matching row in [begin, end), in row
+// order, to rows[] and scores[] (room for end - begin entries each).
+// Returns the number of matches.
+int filter_score_range(const PackageStore* s, const Query* q, int begin, int end,
+                       int* rows, double* scores);
+
+#endif
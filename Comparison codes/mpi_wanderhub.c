@@ -1,191 +1,419 @@
+// mpi_wanderhub.c
+// Build: mpicc mpi_wanderhub.c filter_kernel.c package_index.c package_store.c query.c query_engine.c string_dict.c topk.c -o mpi_wanderhub -lm -pthread
+// Hybrid MPI+OpenMP: add -fopenmp; each rank then parses and searches its
+// partition with OMP_NUM_THREADS threads (run e.g. one rank per socket)
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <mpi.h>
-
-#define MAX_LINE_LENGTH 2048
-#define MAX_PACKAGES 1000
-#define MAX_FIELDS 20
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "package_store.h"
+#include "query.h"
+#include "topk.h"
+#include "package_index.h"
+#include "query_engine.h"
+
+#define MAX_TOPK 1000
 #define MAX_QUERY 1024
-
-// ---------------- Global arrays (no structs) ----------------
-char package_ids[MAX_PACKAGES][32];
-char place_names[MAX_PACKAGES][256];
-char provinces[MAX_PACKAGES][128];
-char categories[MAX_PACKAGES][128];
-int duration_days[MAX_PACKAGES];
-double avg_prices[MAX_PACKAGES];
-double ratings[MAX_PACKAGES];
-int reviews_counts[MAX_PACKAGES];
-double popularity_scores[MAX_PACKAGES];
-
-int total_packages = 0;
-
-// ---------------- Query parameters (defaults) ----------------
-char query_province[128] = "";
-char query_category[128] = "";
-double query_budget_min = 0.0;
-double query_budget_max = 1000000.0;
-int query_days = -1;
-double query_min_rating = 0.0;
-int query_topk = 5;
-
-// ---------------- Helpers ----------------
-int is_only_number(const char *s) {
-    if (s == NULL || s[0] == '\0') return 0;
-    for (int i = 0; s[i]; i++) {
-        if (s[i] < '0' || s[i] > '9') return 0;
+#define MAX_LINE 512     // one formatted recommendation, without its number and score
+#define TAIL_READ 4096   // bytes read at a time past a rank's range to finish its last line
+#define READ_PIECE (1 << 30)   // most bytes per collective read (MPI counts are ints)
+#define DEFAULT_IN_FLIGHT 4
+#define MAX_IN_FLIGHT 64
+
+// ---------------- Package catalogue (this rank's partition) ----------------
+PackageStore store;
+PackageIndex store_index;   // posting lists over the partition
+int row_offset = 0;         // dataset row number of the partition's first row
+int team_threads = 1;       // OpenMP threads per rank (1 without -fopenmp)
+
+// ---------------- Partitioned load with MPI-IO ----------------
+// Collectively read length bytes at offset into buf, in pieces of at most
+// READ_PIECE bytes so a partition over 2 GiB is not cut at an int count.
+// Every rank makes as many calls as the rank with the most pieces, reading
+// 0 bytes once it is done. Returns 0, or -1 if a piece fails or comes back
+// short.
+int read_range_all(MPI_File fh, MPI_Offset offset, char* buf, size_t length) {
+    long long pieces = (long long)((length + READ_PIECE - 1) / READ_PIECE);
+    long long max_pieces = 0;
+    MPI_Allreduce(&pieces, &max_pieces, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+
+    int status = 0;
+    for (long long p = 0; p < max_pieces; p++) {
+        size_t done = (size_t)p * READ_PIECE;
+        int want = 0;
+        if (status == 0 && done < length) {
+            want = (length - done < READ_PIECE) ? (int)(length - done) : READ_PIECE;
+        }
+        MPI_Status st;
+        int got = 0;
+        if (MPI_File_read_at_all(fh, offset + (MPI_Offset)done, (want > 0) ? buf + done : buf,
+                                 want, MPI_CHAR, &st) != MPI_SUCCESS ||
+            MPI_Get_count(&st, MPI_CHAR, &got) != MPI_SUCCESS || got != want) {
+            status = -1;
+        }
     }
-    return 1;
+    return status;
 }
 
-void reset_query_defaults() {
-    strcpy(query_province, "");
-    strcpy(query_category, "");
-    query_budget_min = 0.0;
-    query_budget_max = 1000000.0;
-    query_days = -1;
-    query_min_rating = 0.0;
-    query_topk = 5;
-}
+// The file is cut into one equal byte range per rank, and a rank owns the
+// lines that start inside its range. It reads its range plus the byte before
+// it (to tell whether the range starts a line; if not, the partial line is
+// the previous rank's), then reads on past the range until the newline
+// ending its last line. Each rank parses and keeps only its own lines, so
+// load time and memory per rank shrink as ranks are added. Returns 0, or -1
+// if the file cannot be read or memory runs out.
+int load_partition(const char* path, int rank, int world) {
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        return -1;
+    }
+    MPI_Offset size;
+    MPI_File_get_size(fh, &size);
+    MPI_Offset begin = size * rank / world;
+    MPI_Offset end = size * (rank + 1) / world;
+    MPI_Offset from = (begin > 0) ? begin - 1 : 0;
+
+    // The range itself, read collectively
+    size_t range = (size_t)(end - from);
+    size_t capacity = range + TAIL_READ;
+    char* buf = (char*)malloc(capacity);
+    int status = (buf != NULL) ? 0 : -1;
+    if (read_range_all(fh, from, buf, (buf != NULL) ? range : 0) != 0) status = -1;
+
+    // Finish the last line, unless the range ends with a newline
+    size_t length = range;
+    int done = (status != 0 || end == size || (length > 0 && buf[length - 1] == '\n'));
+    while (!done) {
+        if (length + TAIL_READ > capacity) {
+            char* grown = (char*)realloc(buf, capacity * 2);
+            if (grown == NULL) {
+                status = -1;
+                break;
+            }
+            buf = grown;
+            capacity *= 2;
+        }
+        MPI_Offset at = from + (MPI_Offset)length;
+        int want = (size - at < TAIL_READ) ? (int)(size - at) : TAIL_READ;
+        MPI_Status st;
+        int got = 0;
+        if (MPI_File_read_at(fh, at, buf + length, want, MPI_CHAR, &st) != MPI_SUCCESS ||
+            MPI_Get_count(&st, MPI_CHAR, &got) != MPI_SUCCESS || got != want) {
+            status = -1;
+            break;
+        }
+        done = (memchr(buf + length, '\n', want) != NULL || at + want == size);
+        length += want;
+    }
+    MPI_File_close(&fh);
+    if (status != 0) {
+        free(buf);
+        return -1;
+    }
 
-// ---------------- Dataset parsing (TAB-delimited) ----------------
-int parse_line(char* line, int package_index) {
-    char* token;
-    int field_index = 0;
-
-    // Skip header line
-    if (strstr(line, "package_id") != NULL) return 0;
-
-    token = strtok(line, "\t");
-    while (token != NULL && field_index < MAX_FIELDS) {
-        char* newline = strchr(token, '\n');
-        if (newline) *newline = '\0';
-
-        if (field_index == 0) strncpy(package_ids[package_index], token, 31);
-        else if (field_index == 1) strncpy(place_names[package_index], token, 255);
-        else if (field_index == 2) strncpy(provinces[package_index], token, 127);
-        else if (field_index == 5) strncpy(categories[package_index], token, 127);
-        else if (field_index == 6) duration_days[package_index] = atoi(token);
-        else if (field_index == 8) avg_prices[package_index] = atof(token);
-        else if (field_index == 12) ratings[package_index] = atof(token);
-        else if (field_index == 13) reviews_counts[package_index] = atoi(token);
-        else if (field_index == 14) popularity_scores[package_index] = atof(token);
-
-        token = strtok(NULL, "\t");
-        field_index++;
+    // Own [first, last): from the first line start at or after begin to the
+    // end of the line holding the range's last byte
+    size_t range_end = (size_t)(end - from);
+    size_t first = 0;
+    if (begin > 0) {
+        const char* nl = (const char*)memchr(buf, '\n', range_end);
+        first = (nl != NULL) ? (size_t)(nl - buf) + 1 : range_end;
+    }
+    size_t last = first;
+    if (first < range_end) {
+        const char* nl = (const char*)memchr(buf + range_end - 1, '\n', length - (range_end - 1));
+        last = (nl != NULL) ? (size_t)(nl - buf) + 1 : length;
     }
 
-    return 1;
+    memmove(buf, buf + first, last - first);
+    return store_load_tsv_buffer(&store, buf, last - first, team_threads);
 }
 
-// ---------------- Query parsing ----------------
-void parse_query(char* query_str) {
-    reset_query_defaults();
+// ---------------- Candidates sent to rank 0 ----------------
+// Only the rank holding a row can print it, so each local recommendation
+// travels with its display fields already formatted.
+typedef struct {
+    double score;
+    int row;                 // dataset row number
+    char line[MAX_LINE];     // "id | place, province | ... | Rating: r"
+} Candidate;
+
+void format_candidate(Candidate* c, int local_row, double score) {
+    c->score = score;
+    c->row = row_offset + local_row;
+    snprintf(c->line, MAX_LINE, "%.*s | %.*s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f",
+             STORE_STR(&store, package_ids, local_row),
+             STORE_STR(&store, place_names, local_row),
+             STORE_PROVINCE(&store, local_row),
+             STORE_CATEGORY(&store, local_row),
+             store.duration_days[local_row],
+             store.avg_prices[local_row],
+             store.ratings[local_row]);
+}
 
-    // If just a number like "3" => TOPK=3
-    if (is_only_number(query_str)) {
-        query_topk = atoi(query_str);
-        if (query_topk < 1) query_topk = 1;
-        if (query_topk > MAX_PACKAGES) query_topk = MAX_PACKAGES;
-        return;
-    }
+// ---------------- Top-K reduction ----------------
+// Each rank contributes one buffer: a header with its match count, then its
+// best candidates ordered best-first. merge_topk_op merges two buffers into
+// the best K of both (score descending, dataset row ascending on ties), so
+// MPI_Reduce combines the ranks' lists pairwise up its tree. Rank 0 gets the
+// final list and the total match count from that one collective, having
+// merged at most K candidates per tree level.
+typedef struct {
+    int matched;     // matches behind this list
+    int count;       // candidates that follow
+    int capacity;    // room for K candidates
+    int pad;         // keeps the candidates 8-byte aligned
+} TopKHeader;
+
+Candidate* merge_scratch = NULL;   // MAX_TOPK candidates, for merge_topk_op
+MPI_Op merge_op;
+
+int candidate_before(const Candidate* a, const Candidate* b) {
+    return a->score > b->score || (a->score == b->score && a->row < b->row);
+}
 
-    // Example:
-    // PROVINCE=Punjab;CATEGORY=Nature;BUDGET_MIN=10000;BUDGET_MAX=30000;DAYS=3;MIN_RATING=4.0;TOPK=5
-    char* token = strtok(query_str, ";");
-    while (token != NULL) {
-        if (strncmp(token, "PROVINCE=", 9) == 0) strcpy(query_province, token + 9);
-        else if (strncmp(token, "CATEGORY=", 9) == 0) strcpy(query_category, token + 9);
-        else if (strncmp(token, "BUDGET_MIN=", 11) == 0) query_budget_min = atof(token + 11);
-        else if (strncmp(token, "BUDGET_MAX=", 11) == 0) query_budget_max = atof(token + 11);
-        else if (strncmp(token, "DAYS=", 5) == 0) query_days = atoi(token + 5);
-        else if (strncmp(token, "MIN_RATING=", 11) == 0) query_min_rating = atof(token + 11);
-        else if (strncmp(token, "TOPK=", 5) == 0) query_topk = atoi(token + 5);
-
-        token = strtok(NULL, ";");
+void merge_topk_op(void* in, void* inout, int* len, MPI_Datatype* type) {
+    int size;
+    MPI_Type_size(*type, &size);
+
+    for (int e = 0; e < *len; e++) {
+        TopKHeader* a = (TopKHeader*)((char*)in + (size_t)e * size);
+        TopKHeader* b = (TopKHeader*)((char*)inout + (size_t)e * size);
+        const Candidate* ca = (const Candidate*)(a + 1);
+        Candidate* cb = (Candidate*)(b + 1);
+
+        int i = 0, j = 0, n = 0;
+        while (n < b->capacity && (i < a->count || j < b->count)) {
+            if (j >= b->count || (i < a->count && candidate_before(&ca[i], &cb[j]))) {
+                merge_scratch[n++] = ca[i++];
+            } else {
+                merge_scratch[n++] = cb[j++];
+            }
+        }
+        memcpy(cb, merge_scratch, n * sizeof(Candidate));
+        b->count = n;
+        b->matched += a->matched;
     }
+}
 
-    if (query_topk < 1) query_topk = 1;
-    if (query_topk > MAX_PACKAGES) query_topk = MAX_PACKAGES;
+#ifdef _OPENMP
+// Combine a thread's private heap into another and free it (it is not used
+// again); private copies start empty with the same K
+void topk_combine(TopK* out, TopK* in) {
+    topk_merge(out, in);
+    topk_free(in);
 }
 
-// ---------------- Filter + Score ----------------
-int matches_filter(int index) {
-    if (strlen(query_province) > 0 && strcmp(provinces[index], query_province) != 0) return 0;
-    if (strlen(query_category) > 0 && strcmp(categories[index], query_category) != 0) return 0;
-    if (avg_prices[index] < query_budget_min || avg_prices[index] > query_budget_max) return 0;
-    if (query_days > 0 && duration_days[index] != query_days) return 0;
-    if (ratings[index] < query_min_rating) return 0;
-    return 1;
+#pragma omp declare reduction(topk_merge : TopK : topk_combine(&omp_out, &omp_in)) \
+    initializer(topk_init(&omp_priv, omp_orig.capacity))
+#endif
+
+size_t topk_buffer_size(int k) {
+    return sizeof(TopKHeader) + (size_t)k * sizeof(Candidate);
 }
 
-double calculate_score(int index) {
-    double score = 0.0;
+// Search this rank's partition for q and write its match count and best
+// candidates into buffer (topk_buffer_size(q->topk) bytes)
+void search_partition(const Query* q, char* buffer, int rank) {
+    TopK local;
+    if (topk_init(&local, q->topk) != 0) {
+        printf("Error: Out of memory on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    TopKHeader* header = (TopKHeader*)buffer;
+    Candidate* candidates = (Candidate*)(header + 1);
+    int matched = 0;
+#ifdef _OPENMP
+    // The rank's team splits the partition into one row slice per thread,
+    // each searched into a private heap. Only this thread calls MPI, which
+    // is all MPI_THREAD_FUNNELED allows.
+    #pragma omp parallel reduction(topk_merge : local) reduction(+ : matched)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int begin = (int)((long long)t * store.count / threads);
+        int end = (int)((long long)(t + 1) * store.count / threads);
+        matched += engine_topk(&store, &store_index, q, begin, end, &local);
+    }
+#else
+    matched = engine_topk(&store, &store_index, q, 0, store.count, &local);
+#endif
+    header->matched = matched;
+    header->count = topk_sort(&local);   // best-first
+    header->capacity = q->topk;
+    header->pad = 0;
+    for (int i = 0; i < header->count; i++) {
+        format_candidate(&candidates[i], local.indices[i], local.scores[i]);
+    }
+    topk_free(&local);
+}
 
-    score += 50.0 * ratings[index];
-    score += 10.0 * popularity_scores[index];
-    score += 5.0 * log(reviews_counts[index] + 1.0);
+// ---------------- Query service ----------------
+// Rank 0 reads queries (one per line) and sends them out in windows of
+// in_flight slots. Each slot is broadcast with MPI_Ibcast as the parsed
+// Query (fixed size, so no length has to go first); the other ranks resolve
+// its names in their own dictionaries. A rank answers the slots in order as
+// their broadcasts complete and starts an MPI_Ireduce for each, so the
+// later broadcasts and the earlier reductions progress while it searches.
+// A slot with active == 0 means the input has ended.
+typedef struct {
+    int active;
+    int pad;
+    Query q;
+} QueryMessage;
+
+typedef struct {
+    char text[MAX_QUERY];          // rank 0: the query line
+    char* send_buffer;
+    char* result_buffer;           // rank 0
+    MPI_Datatype type;
+} Slot;
+
+// Read the next non-blank line (newline stripped). 0 at end of input.
+int read_query_line(FILE* in, char* line, int size) {
+    while (fgets(line, size, in) != NULL) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] != '\0') return 1;
+    }
+    return 0;
+}
 
-    if (query_budget_max < 1000000.0) {
-        double budget_diff = fabs(avg_prices[index] - query_budget_max);
-        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
-        score += budget_closeness;
+int run_service(const char* query_file, int in_flight, int rank, int world) {
+    FILE* in = NULL;
+    if (rank == 0) {
+        in = (strcmp(query_file, "-") == 0) ? stdin : fopen(query_file, "r");
+    }
+    int opened = (rank != 0 || in != NULL);
+    MPI_Bcast(&opened, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (!opened) {
+        if (rank == 0) printf("Error: Cannot read query file %s\n", query_file);
+        return 1;
     }
 
-    if (query_days > 0) {
-        int duration_diff = abs(duration_days[index] - query_days);
-        double duration_closeness = 50.0 / (1.0 + duration_diff);
-        score += duration_closeness;
+    QueryMessage* messages = (QueryMessage*)calloc(in_flight, sizeof(QueryMessage));
+    Slot* slots = (Slot*)calloc(in_flight, sizeof(Slot));
+    MPI_Request* bcasts = (MPI_Request*)malloc(in_flight * sizeof(MPI_Request));
+    MPI_Request* reduces = (MPI_Request*)malloc(in_flight * sizeof(MPI_Request));
+    if (messages == NULL || slots == NULL || bcasts == NULL || reduces == NULL) {
+        printf("Error: Out of memory on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    if (rank == 0) {
+        printf("Serving queries from %s with %d MPI processes x %d threads, %d in flight.\n",
+               (in == stdin) ? "stdin" : query_file, world, team_threads, in_flight);
     }
 
-    return score;
-}
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = MPI_Wtime();
+    int served = 0;
+    int ended = 0;
 
-// Bubble sort (descending by score)
-void sort_topk(int* indices, double* scores, int count) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (scores[j] < scores[j + 1]) {
-                double ts = scores[j];
-                scores[j] = scores[j + 1];
-                scores[j + 1] = ts;
-
-                int ti = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = ti;
+    while (!ended) {
+        // Rank 0 fills the window; once input ends the remaining slots stay inactive
+        if (rank == 0) {
+            int more = 1;
+            for (int i = 0; i < in_flight; i++) {
+                more = more && read_query_line(in, slots[i].text, MAX_QUERY);
+                messages[i].active = more;
+                if (!more) continue;
+                query_parse(&messages[i].q, slots[i].text, &store);
+                if (messages[i].q.topk < 1) messages[i].q.topk = 1;
+                if (messages[i].q.topk > MAX_TOPK) messages[i].q.topk = MAX_TOPK;
             }
         }
+        for (int i = 0; i < in_flight; i++) {
+            MPI_Ibcast(&messages[i], (int)sizeof(QueryMessage), MPI_BYTE, 0, MPI_COMM_WORLD, &bcasts[i]);
+        }
+
+        // Answer each slot as it arrives and start its reduction
+        int active = 0;
+        for (int i = 0; i < in_flight; i++) {
+            MPI_Wait(&bcasts[i], MPI_STATUS_IGNORE);
+            if (!messages[i].active) {
+                ended = 1;
+                continue;
+            }
+            Query* q = &messages[i].q;
+            if (rank != 0) query_resolve(q, &store);
+
+            Slot* slot = &slots[i];
+            size_t size = topk_buffer_size(q->topk);
+            slot->send_buffer = (char*)malloc(size);
+            slot->result_buffer = (rank == 0) ? (char*)malloc(size) : NULL;
+            if (slot->send_buffer == NULL || (rank == 0 && slot->result_buffer == NULL)) {
+                printf("Error: Out of memory on rank %d\n", rank);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+            search_partition(q, slot->send_buffer, rank);
+
+            MPI_Type_contiguous((int)size, MPI_BYTE, &slot->type);
+            MPI_Type_commit(&slot->type);
+            MPI_Ireduce(slot->send_buffer, slot->result_buffer, 1, slot->type, merge_op, 0,
+                        MPI_COMM_WORLD, &reduces[active]);
+            active++;
+        }
+        MPI_Waitall(active, reduces, MPI_STATUSES_IGNORE);
+
+        // Active slots are the first ones of the window
+        for (int i = 0; i < active; i++) {
+            Slot* slot = &slots[i];
+            if (rank == 0) {
+                TopKHeader* result = (TopKHeader*)slot->result_buffer;
+                const Candidate* best = (const Candidate*)(result + 1);
+                printf("\n[%d] Query: %s\n", served + i + 1, slot->text);
+                printf("Found %d matching packages.\n", result->matched);
+                for (int k = 0; k < result->count; k++) {
+                    printf("%d. %s | Score: %.2f\n", k + 1, best[k].line, best[k].score);
+                }
+            }
+            MPI_Type_free(&slot->type);
+            free(slot->send_buffer);
+            free(slot->result_buffer);
+            slot->send_buffer = NULL;
+            slot->result_buffer = NULL;
+        }
+        served += active;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t1 = MPI_Wtime();
+    if (rank == 0) {
+        printf("\nServed %d queries with %d MPI processes (%d in flight): %.4f seconds", served, world, in_flight, t1 - t0);
+        if (t1 > t0) printf(" (%.0f queries/sec)", served / (t1 - t0));
+        printf("\n");
+        if (in != stdin) fclose(in);
     }
-}
 
-// ---------------- Broadcast dataset from rank 0 to all ranks ----------------
-void bcast_dataset(int rank) {
-    MPI_Bcast(&total_packages, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // Broadcast fixed-size arrays (full MAX_PACKAGES)
-    MPI_Bcast(package_ids,        MAX_PACKAGES * 32,  MPI_CHAR,   0, MPI_COMM_WORLD);
-    MPI_Bcast(place_names,        MAX_PACKAGES * 256, MPI_CHAR,   0, MPI_COMM_WORLD);
-    MPI_Bcast(provinces,          MAX_PACKAGES * 128, MPI_CHAR,   0, MPI_COMM_WORLD);
-    MPI_Bcast(categories,         MAX_PACKAGES * 128, MPI_CHAR,   0, MPI_COMM_WORLD);
-
-    MPI_Bcast(duration_days,      MAX_PACKAGES,       MPI_INT,    0, MPI_COMM_WORLD);
-    MPI_Bcast(avg_prices,         MAX_PACKAGES,       MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    MPI_Bcast(ratings,            MAX_PACKAGES,       MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    MPI_Bcast(reviews_counts,     MAX_PACKAGES,       MPI_INT,    0, MPI_COMM_WORLD);
-    MPI_Bcast(popularity_scores,  MAX_PACKAGES,       MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    free(messages);
+    free(slots);
+    free(bcasts);
+    free(reduces);
+    return 0;
 }
 
 // ---------------- Main ----------------
 int main(int argc, char** argv) {
-    MPI_Init(&argc, &argv);
+    // Threads never call MPI themselves, so FUNNELED is enough for the hybrid build
+    int provided;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
 
     int rank, world;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &world);
 
+#ifdef _OPENMP
+    team_threads = omp_get_max_threads();
+    if (provided < MPI_THREAD_FUNNELED && team_threads > 1) {
+        if (rank == 0) printf("Warning: MPI lacks MPI_THREAD_FUNNELED; using 1 thread per rank\n");
+        team_threads = 1;
+    }
+    omp_set_num_threads(team_threads);
+#endif
+
     if (argc < 2) {
         if (rank == 0) {
             printf("Usage:\n");
@@ -194,41 +422,74 @@ int main(int argc, char** argv) {
             printf("  mpirun -np 4 %s package_dataset_pakistan.txt \"TOPK=5\"\n", argv[0]);
             printf("  mpirun -np 4 %s package_dataset_pakistan.txt \"PROVINCE=Punjab;CATEGORY=Nature;TOPK=3\"\n", argv[0]);
             printf("  mpirun -np 4 %s package_dataset_pakistan.txt 3   (means TOPK=3)\n", argv[0]);
+            printf("Service mode (dataset stays loaded; queries one per line, - for stdin):\n");
+            printf("  mpirun -np <P> %s <dataset_file> --serve <query_file | -> [in_flight]\n", argv[0]);
         }
         MPI_Finalize();
         return 1;
     }
 
-    // -------- Rank 0 loads dataset --------
-    if (rank == 0) {
-        const char* dataset_file = argv[1];
-        FILE* file = fopen(dataset_file, "r");
-        if (file == NULL) {
-            printf("Error: Cannot open file %s\n", dataset_file);
-            total_packages = 0;
-        } else {
-            char line[MAX_LINE_LENGTH];
-            total_packages = 0;
-            printf("Loading dataset from %s...\n", dataset_file);
-
-            while (fgets(line, MAX_LINE_LENGTH, file) != NULL && total_packages < MAX_PACKAGES) {
-                char line_copy[MAX_LINE_LENGTH];
-                strcpy(line_copy, line);
-                if (parse_line(line_copy, total_packages)) {
-                    total_packages++;
-                }
-            }
-            fclose(file);
-            printf("Loaded %d packages.\n", total_packages);
-        }
+    // -------- Every rank loads its own part of the dataset --------
+    const char* dataset_file = argv[1];
+    if (rank == 0) printf("Loading dataset from %s...\n", dataset_file);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double load_start = MPI_Wtime();
+    int status = load_partition(dataset_file, rank, world);
+    int failed = 0;
+    MPI_Allreduce(&status, &failed, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    if (failed != 0) {
+        if (rank == 0) printf("Error: Cannot open file %s\n", dataset_file);
+        store_free(&store);
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Number the partitions' rows in dataset order
+    MPI_Exscan(&store.count, &row_offset, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) row_offset = 0;   // MPI_Exscan leaves rank 0's result undefined
+    int total_rows = 0, min_rows = 0, max_rows = 0;
+    MPI_Reduce(&store.count, &total_rows, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&store.count, &min_rows, 1, MPI_INT, MPI_MIN, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&store.count, &max_rows, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (rank == 0) printf("Loaded %d packages.\n", total_rows);
+
+    // Each rank indexes its own partition
+    MPI_Barrier(MPI_COMM_WORLD);
+    double index_start = MPI_Wtime();
+    if (index_build(&store_index, &store) != 0) {
+        printf("Error: Out of memory on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double index_end = MPI_Wtime();
+
+    // Top-K merge operator (commutative: ties go by row) and its scratch
+    merge_scratch = (Candidate*)malloc(MAX_TOPK * sizeof(Candidate));
+    if (merge_scratch == NULL) {
+        printf("Error: Out of memory on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    MPI_Op_create(merge_topk_op, 1, &merge_op);
+
+    if (argc >= 3 && strcmp(argv[2], "--serve") == 0) {
+        const char* query_file = (argc >= 4) ? argv[3] : "-";
+        int in_flight = (argc >= 5) ? atoi(argv[4]) : DEFAULT_IN_FLIGHT;
+        if (in_flight < 1) in_flight = 1;
+        if (in_flight > MAX_IN_FLIGHT) in_flight = MAX_IN_FLIGHT;
 
-    // Broadcast dataset to all ranks
-    bcast_dataset(rank);
+        status = run_service(query_file, in_flight, rank, world);
+
+        MPI_Op_free(&merge_op);
+        free(merge_scratch);
+        index_free(&store_index);
+        store_free(&store);
+        MPI_Finalize();
+        return status;
+    }
 
     // -------- Read query on rank 0, broadcast to all --------
     char query_str[MAX_QUERY];
-    char query_original[MAX_QUERY];
 
     if (rank == 0) {
         if (argc >= 3) {
@@ -248,144 +509,81 @@ int main(int argc, char** argv) {
 
             if (strlen(query_str) == 0) strcpy(query_str, "TOPK=5");
         }
-
-        strncpy(query_original, query_str, sizeof(query_original) - 1);
-        query_original[sizeof(query_original) - 1] = '\0';
     }
 
     // Broadcast query to all ranks
     MPI_Bcast(query_str, MAX_QUERY, MPI_CHAR, 0, MPI_COMM_WORLD);
 
-    // Parse query on each rank (strtok modifies string -> use local copy)
-    char query_copy[MAX_QUERY];
-    strncpy(query_copy, query_str, sizeof(query_copy) - 1);
-    query_copy[sizeof(query_copy) - 1] = '\0';
-    parse_query(query_copy);
+    // Parse query on each rank (every rank resolves names in its own partition's dictionaries)
+    Query q;
+    query_parse(&q, query_str, &store);
+    if (q.topk < 1) q.topk = 1;
+    if (q.topk > MAX_TOPK) q.topk = MAX_TOPK;
 
     if (rank == 0) {
-        printf("\nQuery: %s\n", (argc >= 3) ? argv[2] : query_original);
-        printf("Using %d MPI processes.\n", world);
+        printf("\nQuery: %s\n", (argc >= 3) ? argv[2] : query_str);
+        if (team_threads > 1) printf("Using %d MPI processes x %d OpenMP threads.\n", world, team_threads);
+        else printf("Using %d MPI processes.\n", world);
         printf("Filters: Province=%s, Category=%s, Budget=[%.0f-%.0f], Days=%d, MinRating=%.1f, TopK=%d\n\n",
-               strlen(query_province) > 0 ? query_province : "ANY",
-               strlen(query_category) > 0 ? query_category : "ANY",
-               query_budget_min, query_budget_max,
-               query_days > 0 ? query_days : -1,
-               query_min_rating, query_topk);
+               strlen(q.province) > 0 ? q.province : "ANY",
+               strlen(q.category) > 0 ? q.category : "ANY",
+               q.budget_min, q.budget_max,
+               q.days > 0 ? q.days : -1,
+               q.min_rating, q.topk);
     }
 
     MPI_Barrier(MPI_COMM_WORLD);
     double t0 = MPI_Wtime();
 
-    // -------- Divide work across ranks --------
-    int start = (rank * total_packages) / world;
-    int end   = ((rank + 1) * total_packages) / world;
-
-    int local_indices[MAX_PACKAGES];
-    double local_scores[MAX_PACKAGES];
-    int local_count = 0;
-
-    for (int i = start; i < end; i++) {
-        if (matches_filter(i)) {
-            local_indices[local_count] = i;
-            local_scores[local_count] = calculate_score(i);
-            local_count++;
-        }
-    }
-
-    if (local_count > 0) sort_topk(local_indices, local_scores, local_count);
-
-    int local_topk = (local_count < query_topk) ? local_count : query_topk;
-
-    // Prepare arrays to send only topk
-    int send_idx[MAX_PACKAGES];
-    double send_sc[MAX_PACKAGES];
-    for (int i = 0; i < local_topk; i++) {
-        send_idx[i] = local_indices[i];
-        send_sc[i] = local_scores[i];
+    // -------- Each rank searches its partition --------
+    size_t buffer_size = topk_buffer_size(q.topk);
+    char* send_buffer = (char*)malloc(buffer_size);
+    char* result_buffer = (rank == 0) ? (char*)malloc(buffer_size) : NULL;
+    if (send_buffer == NULL || (rank == 0 && result_buffer == NULL)) {
+        printf("Error: Out of memory on rank %d\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    search_partition(&q, send_buffer, rank);
 
-    // -------- Gather match counts for summary --------
-    int* all_match_counts = NULL;
-    if (rank == 0) all_match_counts = (int*)malloc(world * sizeof(int));
-    MPI_Gather(&local_count, 1, MPI_INT, all_match_counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // -------- Gather topk counts to know receive sizes --------
-    int* recv_counts = NULL;
-    if (rank == 0) recv_counts = (int*)malloc(world * sizeof(int));
-    MPI_Gather(&local_topk, 1, MPI_INT, recv_counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
-
-    // -------- Gatherv topk indices + scores to rank 0 --------
-    int* displs = NULL;
-    int total_recv = 0;
-
-    int* all_indices = NULL;
-    double* all_scores = NULL;
-
-    if (rank == 0) {
-        displs = (int*)malloc(world * sizeof(int));
-        displs[0] = 0;
-        total_recv = recv_counts[0];
-        for (int i = 1; i < world; i++) {
-            displs[i] = displs[i - 1] + recv_counts[i - 1];
-            total_recv += recv_counts[i];
-        }
-
-        all_indices = (int*)malloc((total_recv > 0 ? total_recv : 1) * sizeof(int));
-        all_scores  = (double*)malloc((total_recv > 0 ? total_recv : 1) * sizeof(double));
-    }
-
-    MPI_Gatherv(send_idx, local_topk, MPI_INT,
-                all_indices, recv_counts, displs, MPI_INT,
-                0, MPI_COMM_WORLD);
-
-    MPI_Gatherv(send_sc, local_topk, MPI_DOUBLE,
-                all_scores, recv_counts, displs, MPI_DOUBLE,
-                0, MPI_COMM_WORLD);
+    // -------- Merge every rank's list and match count up a tree to rank 0 --------
+    MPI_Datatype topk_type;
+    MPI_Type_contiguous((int)buffer_size, MPI_BYTE, &topk_type);
+    MPI_Type_commit(&topk_type);
+    MPI_Reduce(send_buffer, result_buffer, 1, topk_type, merge_op, 0, MPI_COMM_WORLD);
+    MPI_Type_free(&topk_type);
 
     MPI_Barrier(MPI_COMM_WORLD);
     double t1 = MPI_Wtime();
 
-    // -------- Rank 0 merges + prints final results --------
+    // -------- Rank 0 prints final results --------
     if (rank == 0) {
-        int total_matched = 0;
-        for (int i = 0; i < world; i++) total_matched += all_match_counts[i];
+        TopKHeader* result = (TopKHeader*)result_buffer;
+        const Candidate* best = (const Candidate*)(result + 1);
 
         printf("------------------------------------------------------------\n");
-        printf("TOTAL MATCHED (sum of ranks): %d\n", total_matched);
-
-        if (total_recv > 0) {
-            // Sort merged candidates (only total_recv items, at most world*TOPK)
-            sort_topk(all_indices, all_scores, total_recv);
-
-            int final_topk = (total_recv < query_topk) ? total_recv : query_topk;
-            printf("\n==== FINAL TOP %d Recommendations (MPI/OpenMPI) ====\n", final_topk);
-
-            for (int i = 0; i < final_topk; i++) {
-                int idx = all_indices[i];
-                printf("%d. %s | %s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
-                       i + 1,
-                       package_ids[idx],
-                       place_names[idx],
-                       provinces[idx],
-                       categories[idx],
-                       duration_days[idx],
-                       avg_prices[idx],
-                       ratings[idx],
-                       all_scores[i]);
+        printf("TOTAL MATCHED (sum of ranks): %d\n", result->matched);
+
+        if (result->count > 0) {
+            printf("\n==== FINAL TOP %d Recommendations (MPI/OpenMPI) ====\n", result->count);
+            for (int i = 0; i < result->count; i++) {
+                printf("%d. %s | Score: %.2f\n", i + 1, best[i].line, best[i].score);
             }
         } else {
             printf("No packages match the query filters.\n");
         }
 
         printf("\nExecution Time (MPI with %d processes): %.4f seconds\n", world, (t1 - t0));
-
-        free(all_match_counts);
-        free(recv_counts);
-        free(displs);
-        free(all_indices);
-        free(all_scores);
+        printf("Time split: load %.4f s (%d-%d rows per rank), index %.4f s, query %.4f s\n",
+               index_start - load_start, min_rows, max_rows, index_end - index_start, t1 - t0);
     }
 
+    free(send_buffer);
+    free(result_buffer);
+    MPI_Op_free(&merge_op);
+    free(merge_scratch);
+    index_free(&store_index);
+    store_free(&store);
+
     MPI_Finalize();
     return 0;
 }
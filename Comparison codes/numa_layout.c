@@ -0,0 +1,232 @@
+#define _GNU_SOURCE   // sched_setaffinity / CPU_SET
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "numa_layout.h"
+
+#define SYSFS_NODES "/sys/devices/system/node"
+
+// Add the CPUs of a sysfs cpulist ("0-3,8-11") that are in allowed to
+// t->cpus. Returns how many were added.
+static int add_cpulist(NumaTopology* t, int total, const char* list, const cpu_set_t* allowed) {
+    int added = 0;
+    const char* p = list;
+    while (*p >= '0' && *p <= '9') {
+        char* next;
+        int first = (int)strtol(p, &next, 10);
+        int last = first;
+        if (*next == '-') last = (int)strtol(next + 1, &next, 10);
+        for (int cpu = first; cpu <= last && total + added < NUMA_MAX_CPUS; cpu++) {
+            if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, allowed)) t->cpus[total + added++] = cpu;
+        }
+        if (*next != ',') break;
+        p = next + 1;
+    }
+    return added;
+}
+
+void numa_topology(NumaTopology* t) {
+    memset(t, 0, sizeof(*t));
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) CPU_SET(cpu, &allowed);
+    }
+
+    int total = 0;
+    for (int id = 0; id < 4 * NUMA_MAX_NODES && t->num_nodes < NUMA_MAX_NODES; id++) {
+        char path[128];
+        snprintf(path, sizeof(path), SYSFS_NODES "/node%d/cpulist", id);
+        FILE* f = fopen(path, "r");
+        if (f == NULL) continue;
+        char list[4096];
+        int n = 0;
+        if (fgets(list, sizeof(list), f) != NULL) n = add_cpulist(t, total, list, &allowed);
+        fclose(f);
+        if (n == 0) continue;   // memory-only node, or none of its CPUs allowed
+
+        t->node_ids[t->num_nodes] = id;
+        t->node_first[t->num_nodes] = total;
+        t->node_cpus[t->num_nodes] = n;
+        t->num_nodes++;
+        total += n;
+    }
+    if (t->num_nodes > 0) return;
+
+    // No sysfs nodes: one node with every allowed CPU
+    for (int cpu = 0; cpu < CPU_SETSIZE && total < NUMA_MAX_CPUS; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) t->cpus[total++] = cpu;
+    }
+    if (total == 0) t->cpus[total++] = 0;
+    t->num_nodes = 1;
+    t->node_cpus[0] = total;
+}
+
+int numa_worker_node(const NumaTopology* t, int worker, int num_workers) {
+    return (int)((long long)worker * t->num_nodes / num_workers);
+}
+
+int numa_worker_cpu(const NumaTopology* t, int worker, int num_workers) {
+    int node = numa_worker_node(t, worker, num_workers);
+    // First worker of this node, so its workers spread over its CPUs
+    int first_worker = (int)(((long long)node * num_workers + t->num_nodes - 1) / t->num_nodes);
+    int k = (worker - first_worker) % t->node_cpus[node];
+    return t->cpus[t->node_first[node] + k];
+}
+
+int numa_pin_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return (sched_setaffinity(0, sizeof(set), &set) == 0) ? 0 : -1;
+}
+
+// ---------------- Placement ----------------
+
+typedef struct {
+    const PackageStore* s;       // columns to copy from
+    const NumaPlacement* dst;    // placed columns (same field names)
+    int begin;
+    int end;
+    int cpu;
+} PlaceJob;
+
+#define COPY_ROWS(field) \
+    memcpy(job->dst->field + job->begin, job->s->field + job->begin, \
+           (size_t)(job->end - job->begin) * sizeof(*job->s->field))
+
+static void* place_rows(void* arg) {
+    PlaceJob* job = (PlaceJob*)arg;
+    numa_pin_cpu(job->cpu);   // unpinned, the pages still land somewhere valid
+    COPY_ROWS(province_codes);
+    COPY_ROWS(category_codes);
+    COPY_ROWS(duration_days);
+    COPY_ROWS(avg_prices);
+    COPY_ROWS(ratings);
+    COPY_ROWS(base_scores);
+    return NULL;
+}
+
+// Page-aligned slot for a column of rows elements of elem_size bytes
+static size_t column_slot(size_t* size, int rows, size_t elem_size, size_t page) {
+    size_t offset = *size;
+    *size += ((size_t)rows * elem_size + page - 1) / page * page;
+    return offset;
+}
+
+int numa_place_store(PackageStore* s, const NumaTopology* t, int num_workers, NumaPlacement* p) {
+    memset(p, 0, sizeof(*p));
+    if (num_workers < 1) num_workers = 1;
+    int rows = (s->count > 0) ? s->count : 1;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+    size_t size = 0;
+    size_t province_at = column_slot(&size, rows, sizeof(unsigned char), page);
+    size_t category_at = column_slot(&size, rows, sizeof(unsigned char), page);
+    size_t days_at = column_slot(&size, rows, sizeof(int), page);
+    size_t prices_at = column_slot(&size, rows, sizeof(double), page);
+    size_t ratings_at = column_slot(&size, rows, sizeof(double), page);
+    size_t scores_at = column_slot(&size, rows, sizeof(double), page);
+
+    // Fresh anonymous pages have no node until first written
+    char* map = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) return -1;
+
+    NumaPlacement placed;
+    memset(&placed, 0, sizeof(placed));
+    placed.province_codes = (unsigned char*)(map + province_at);
+    placed.category_codes = (unsigned char*)(map + category_at);
+    placed.duration_days = (int*)(map + days_at);
+    placed.avg_prices = (double*)(map + prices_at);
+    placed.ratings = (double*)(map + ratings_at);
+    placed.base_scores = (double*)(map + scores_at);
+
+    PlaceJob* jobs = (PlaceJob*)calloc(num_workers, sizeof(PlaceJob));
+    pthread_t* threads = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+    if (jobs == NULL || threads == NULL) {
+        free(jobs);
+        free(threads);
+        munmap(map, size);
+        return -1;
+    }
+    for (int w = 0; w < num_workers; w++) {
+        jobs[w].s = s;
+        jobs[w].dst = &placed;
+        jobs[w].begin = (int)((long long)w * s->count / num_workers);
+        jobs[w].end = (int)((long long)(w + 1) * s->count / num_workers);
+        jobs[w].cpu = numa_worker_cpu(t, w, num_workers);
+    }
+
+    int started = 0;
+    for (; started < num_workers; started++) {
+        if (pthread_create(&threads[started], NULL, place_rows, &jobs[started]) != 0) break;
+    }
+    int status = (started == num_workers) ? 0 : -1;
+    for (int w = 0; w < started; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    free(jobs);
+    free(threads);
+    if (status != 0) {
+        // A copy on this thread would put those rows on the wrong node
+        munmap(map, size);
+        return -1;
+    }
+
+    // Keep the store's own columns and point it at the placed ones
+    p->map = map;
+    p->size = size;
+    p->province_codes = s->province_codes;
+    p->category_codes = s->category_codes;
+    p->duration_days = s->duration_days;
+    p->avg_prices = s->avg_prices;
+    p->ratings = s->ratings;
+    p->base_scores = s->base_scores;
+    s->province_codes = placed.province_codes;
+    s->category_codes = placed.category_codes;
+    s->duration_days = placed.duration_days;
+    s->avg_prices = placed.avg_prices;
+    s->ratings = placed.ratings;
+    s->base_scores = placed.base_scores;
+    return 0;
+}
+
+void numa_unplace(PackageStore* s, NumaPlacement* p) {
+    if (p->map == NULL) return;
+    s->province_codes = p->province_codes;
+    s->category_codes = p->category_codes;
+    s->duration_days = p->duration_days;
+    s->avg_prices = p->avg_prices;
+    s->ratings = p->ratings;
+    s->base_scores = p->base_scores;
+    munmap(p->map, p->size);
+    memset(p, 0, sizeof(*p));
+}
+
+// ---------------- Report ----------------
+
+void numa_print_bandwidth(const NumaTopology* t, int num_workers,
+                          const long long* rows, const double* busy_seconds) {
+    for (int node = 0; node < t->num_nodes; node++) {
+        int workers = 0;
+        long long node_rows = 0;
+        double busy_max = 0.0;
+        for (int w = 0; w < num_workers; w++) {
+            if (numa_worker_node(t, w, num_workers) != node) continue;
+            workers++;
+            node_rows += rows[w];
+            if (busy_seconds[w] > busy_max) busy_max = busy_seconds[w];
+        }
+        if (workers == 0) continue;
+
+        double mb = node_rows * (double)NUMA_SCAN_ROW_BYTES / 1e6;
+        printf("Node %d: %d threads, %lld rows (%.1f MB), busy %.3f ms",
+               t->node_ids[node], workers, node_rows, mb, busy_max * 1000.0);
+        if (busy_max > 0.0) printf(", %.2f GB/s", mb / 1e3 / busy_max);
+        printf("\n");
+    }
+}
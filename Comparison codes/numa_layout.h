@@ -0,0 +1,75 @@
+#ifndef NUMA_LAYOUT_H
+#define NUMA_LAYOUT_H
+
+#include "package_store.h"
+
+// NUMA-aware placement for the shared-memory recommenders.
+//
+// The topology is read from /sys/devices/system/node (no libnuma needed),
+// restricted to the CPUs this process may run on; without sysfs nodes it
+// is one node holding every allowed CPU. Workers are given to nodes in
+// contiguous blocks (worker w of W runs on node w * nodes / W) and pinned
+// to one CPU of their node, and worker w owns rows
+// [w * count / W, (w + 1) * count / W), the same contiguous split the
+// recommenders' schedulers start from.
+//
+// numa_place_store() copies the columns a scan reads into fresh anonymous
+// memory, each worker's rows written by a thread pinned to that worker's
+// CPU. Linux places a page on the node of the CPU that first touches it,
+// so every worker then scans memory local to its node. Other columns (and
+// the string text) stay where they were: they are only read for the few
+// rows that are printed.
+
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_CPUS 1024
+
+// Bytes of column data a scan reads per row: province and category codes,
+// duration, price, rating and base score
+#define NUMA_SCAN_ROW_BYTES (2 * sizeof(unsigned char) + sizeof(int) + 3 * sizeof(double))
+
+typedef struct {
+    int num_nodes;
+    int node_ids[NUMA_MAX_NODES];      // sysfs node numbers
+    int node_first[NUMA_MAX_NODES];    // first CPU of each node in cpus[]
+    int node_cpus[NUMA_MAX_NODES];     // CPUs of each node
+    int cpus[NUMA_MAX_CPUS];           // allowed CPUs, grouped by node
+} NumaTopology;
+
+typedef struct {
+    void* map;              // anonymous mapping holding the placed columns
+    size_t size;
+
+    // Columns the store had before placement, restored by numa_unplace()
+    unsigned char* province_codes;
+    unsigned char* category_codes;
+    int* duration_days;
+    double* avg_prices;
+    double* ratings;
+    double* base_scores;
+} NumaPlacement;
+
+// Read the node/CPU layout. Always succeeds (falls back to one node).
+void numa_topology(NumaTopology* t);
+
+// Node (index into the topology) and CPU that worker runs on
+int numa_worker_node(const NumaTopology* t, int worker, int num_workers);
+int numa_worker_cpu(const NumaTopology* t, int worker, int num_workers);
+
+// Pin the calling thread to one CPU. 0 or -1.
+int numa_pin_cpu(int cpu);
+
+// Move the scanned columns of s into node-local memory for num_workers
+// workers (see above). The store must not grow or be freed until
+// numa_unplace(). 0, or -1 if memory or threads run out (s is unchanged).
+int numa_place_store(PackageStore* s, const NumaTopology* t, int num_workers, NumaPlacement* p);
+
+// Point s back at its own columns and free the placed copies
+void numa_unplace(PackageStore* s, NumaPlacement* p);
+
+// Print, per node, the rows its workers scanned and the bandwidth they
+// reached (bytes over the busiest worker's time, as a node's workers run
+// side by side). rows[] and busy_seconds[] are per worker.
+void numa_print_bandwidth(const NumaTopology* t, int num_workers,
+                          const long long* rows, const double* busy_seconds);
+
+#endif
@@ -1,170 +1,255 @@
 // openmp_wanderhub.c
 // OpenMP version of WanderHub recommender
 // Same dataset parsing + same query format + same scoring logic as your serial/pthreads
+// Build: gcc -fopenmp openmp_wanderhub.c filter_kernel.c package_index.c package_store.c query.c query_engine.c numa_layout.c snapshot.c string_dict.c topk.c -o openmp_wanderhub -lm -pthread
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <omp.h>
+#include "package_store.h"
+#include "snapshot.h"
+#include "query.h"
+#include "topk.h"
+#include "package_index.h"
+#include "query_engine.h"
+#include "numa_layout.h"
+
+#define MAX_TOPK 1000
+#define NUMA_BENCH_RUNS 20
+
+// ---------------- Package catalogue (columnar, grows with the dataset) ----------------
+PackageStore store;
+PackageIndex store_index;   // posting lists, built once the store is loaded
+
+// ---------------- Top-K reduction ----------------
+// Combine a thread's private heap into another. The private copy is not
+// used after this, so its arrays are freed here.
+void topk_combine(TopK* out, TopK* in) {
+    topk_merge(out, in);
+    topk_free(in);
+}
+
+// Private copies start empty with the same K as the shared heap
+#pragma omp declare reduction(topk_merge : TopK : topk_combine(&omp_out, &omp_in)) \
+    initializer(topk_init(&omp_priv, omp_orig.capacity))
+
+// ---------------- Query ----------------
+// Evaluate q over the whole store into topk (initialised by the caller) and
+// return the number of matches. busy[t] and rows[t] receive thread t's time
+// in the loop and the plan positions (rows, or candidates for an index
+// plan) it evaluated; the caller zeroes them.
+int run_query(const Query* q, TopK* result, double* busy, long long* rows) {
+    // Each thread pushes its matches into a private TopK (reduction below),
+    // so no shared counter or array is touched per match and the merge
+    // handles threads x TOPK entries instead of every match
+    TopK topk = *result;
+    int match_count = 0;
+
+    // Plan once (scan or posting list), then each thread evaluates tiles of
+    // the plan into its own buffers and heap
+    QueryPlan plan;
+    engine_plan(&store_index, q, 0, store.count, &plan);
+    int num_tiles = (plan.length + FILTER_TILE_ROWS - 1) / FILTER_TILE_ROWS;
+
+    #pragma omp parallel reduction(topk_merge : topk) reduction(+ : match_count)
+    {
+        int thread = omp_get_thread_num();
+        long long thread_rows = 0;
+        double t0 = omp_get_wtime();
+
+        #pragma omp for schedule(static) nowait
+        for (int t = 0; t < num_tiles; t++) {
+            int tile_rows[FILTER_TILE_ROWS];
+            double tile_scores[FILTER_TILE_ROWS];
+            int begin = t * FILTER_TILE_ROWS;
+            int end = (begin + FILTER_TILE_ROWS < plan.length) ? begin + FILTER_TILE_ROWS : plan.length;
+
+            int n = engine_eval(&store, q, &plan, begin, end, tile_rows, tile_scores);
+            for (int i = 0; i < n; i++) {
+                topk_push(&topk, tile_rows[i], tile_scores[i]);
+            }
+            match_count += n;
+            thread_rows += end - begin;
+        }
 
-#define MAX_LINE_LENGTH 2048
-#define MAX_PACKAGES 1000
-#define MAX_FIELDS 20
-
-// ---------------- Global arrays (no structs) ----------------
-char package_ids[MAX_PACKAGES][32];
-char place_names[MAX_PACKAGES][256];
-char provinces[MAX_PACKAGES][128];
-char categories[MAX_PACKAGES][128];
-int duration_days[MAX_PACKAGES];
-double avg_prices[MAX_PACKAGES];
-double ratings[MAX_PACKAGES];
-int reviews_counts[MAX_PACKAGES];
-double popularity_scores[MAX_PACKAGES];
-
-int total_packages = 0;
-
-// ---------------- Query parameters (defaults) ----------------
-char query_province[128] = "";
-char query_category[128] = "";
-double query_budget_min = 0.0;
-double query_budget_max = 1000000.0;
-int query_days = -1;
-double query_min_rating = 0.0;
-int query_topk = 5;
-
-// ---------------- Helpers ----------------
-int is_only_number(const char *s) {
-    if (s == NULL || s[0] == '\0') return 0;
-    for (int i = 0; s[i]; i++) {
-        if (s[i] < '0' || s[i] > '9') return 0;
+        busy[thread] = omp_get_wtime() - t0;
+        rows[thread] = thread_rows;
     }
-    return 1;
+
+    *result = topk;
+    return match_count;
 }
 
-void reset_query_defaults() {
-    strcpy(query_province, "");
-    strcpy(query_category, "");
-    query_budget_min = 0.0;
-    query_budget_max = 1000000.0;
-    query_days = -1;
-    query_min_rating = 0.0;
-    query_topk = 5;
+// ---------------- NUMA ----------------
+// Pin every thread of the team to its worker CPU (see numa_layout.h)
+void pin_threads(const NumaTopology* topo) {
+    #pragma omp parallel
+    numa_pin_cpu(numa_worker_cpu(topo, omp_get_thread_num(), omp_get_num_threads()));
 }
 
-// ---------------- Dataset parsing (TAB-delimited) ----------------
-int parse_line(char* line, int package_index) {
-    char* token;
-    int field_index = 0;
-
-    if (strstr(line, "package_id") != NULL) return 0;
-
-    token = strtok(line, "\t");
-    while (token != NULL && field_index < MAX_FIELDS) {
-        char* newline = strchr(token, '\n');
-        if (newline) *newline = '\0';
-
-        if (field_index == 0) strncpy(package_ids[package_index], token, 31);
-        else if (field_index == 1) strncpy(place_names[package_index], token, 255);
-        else if (field_index == 2) strncpy(provinces[package_index], token, 127);
-        else if (field_index == 5) strncpy(categories[package_index], token, 127);
-        else if (field_index == 6) duration_days[package_index] = atoi(token);
-        else if (field_index == 8) avg_prices[package_index] = atof(token);
-        else if (field_index == 12) ratings[package_index] = atof(token);
-        else if (field_index == 13) reviews_counts[package_index] = atoi(token);
-        else if (field_index == 14) popularity_scores[package_index] = atof(token);
-
-        token = strtok(NULL, "\t");
-        field_index++;
+// Run q NUMA_BENCH_RUNS times on the store as loaded with unpinned threads,
+// then again with the scanned columns placed per node and the threads
+// pinned, and compare wall-clock times.
+int run_numa_bench(const Query* q, int num_threads) {
+    NumaTopology topo;
+    numa_topology(&topo);
+    printf("NUMA nodes: %d, CPUs available: %d\n", topo.num_nodes,
+           topo.node_first[topo.num_nodes - 1] + topo.node_cpus[topo.num_nodes - 1]);
+
+    TopK topk;
+    double* busy = (double*)calloc(num_threads, sizeof(double));
+    long long* rows = (long long*)calloc(num_threads, sizeof(long long));
+    if (busy == NULL || rows == NULL || topk_init(&topk, q->topk) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
     }
-    return 1;
-}
 
-// ---------------- Query parsing ----------------
-void parse_query(char* query_str) {
-    reset_query_defaults();
+    double best[2] = { 0.0, 0.0 };
+    NumaPlacement placement;
+    for (int layout = 0; layout < 2; layout++) {
+        if (layout == 1) {
+            if (numa_place_store(&store, &topo, num_threads, &placement) != 0) {
+                printf("Error: Cannot place the store on NUMA nodes\n");
+                return 1;
+            }
+            pin_threads(&topo);
+        }
 
-    // If query is just a number => TOPK
-    if (is_only_number(query_str)) {
-        query_topk = atoi(query_str);
-        if (query_topk < 1) query_topk = 1;
-        if (query_topk > MAX_PACKAGES) query_topk = MAX_PACKAGES;
-        return;
-    }
+        double sum = 0.0;
+        int matches = 0;
+        for (int r = 0; r < NUMA_BENCH_RUNS; r++) {
+            topk_reset(&topk);
+            memset(busy, 0, num_threads * sizeof(double));
+            memset(rows, 0, num_threads * sizeof(long long));
+            double t0 = omp_get_wtime();
+            matches = run_query(q, &topk, busy, rows);
+            double elapsed = omp_get_wtime() - t0;
+            sum += elapsed;
+            if (r == 0 || elapsed < best[layout]) best[layout] = elapsed;
+        }
 
-    char* token = strtok(query_str, ";");
-    while (token != NULL) {
-        if (strncmp(token, "PROVINCE=", 9) == 0) strcpy(query_province, token + 9);
-        else if (strncmp(token, "CATEGORY=", 9) == 0) strcpy(query_category, token + 9);
-        else if (strncmp(token, "BUDGET_MIN=", 11) == 0) query_budget_min = atof(token + 11);
-        else if (strncmp(token, "BUDGET_MAX=", 11) == 0) query_budget_max = atof(token + 11);
-        else if (strncmp(token, "DAYS=", 5) == 0) query_days = atoi(token + 5);
-        else if (strncmp(token, "MIN_RATING=", 11) == 0) query_min_rating = atof(token + 11);
-        else if (strncmp(token, "TOPK=", 5) == 0) query_topk = atoi(token + 5);
-
-        token = strtok(NULL, ";");
+        printf("\n==== %s ====\n", layout == 0 ? "Loaded layout, unpinned threads" : "NUMA layout, pinned threads");
+        printf("%d runs, %d matches: best %.3f ms, average %.3f ms\n",
+               NUMA_BENCH_RUNS, matches, best[layout] * 1000.0, sum / NUMA_BENCH_RUNS * 1000.0);
+        numa_print_bandwidth(&topo, num_threads, rows, busy);
     }
+    numa_unplace(&store, &placement);
+
+    if (best[1] > 0.0) printf("\nNUMA layout speedup (best run): %.2fx\n", best[0] / best[1]);
 
-    if (query_topk < 1) query_topk = 1;
-    if (query_topk > MAX_PACKAGES) query_topk = MAX_PACKAGES;
+    topk_free(&topk);
+    free(busy);
+    free(rows);
+    return 0;
 }
 
-// ---------------- Filter + Score ----------------
-int matches_filter(int index) {
-    if (strlen(query_province) > 0 && strcmp(provinces[index], query_province) != 0) return 0;
-    if (strlen(query_category) > 0 && strcmp(categories[index], query_category) != 0) return 0;
-    if (avg_prices[index] < query_budget_min || avg_prices[index] > query_budget_max) return 0;
-    if (query_days > 0 && duration_days[index] != query_days) return 0;
-    if (ratings[index] < query_min_rating) return 0;
-    return 1;
+// ---------------- Output ----------------
+// Print a sorted TopK as numbered recommendation lines
+void print_recommendations(const TopK* topk, int topk_count) {
+    for (int i = 0; i < topk_count; i++) {
+        int idx = topk->indices[i];
+        printf("%d. %.*s | %.*s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
+               i + 1,
+               STORE_STR(&store, package_ids, idx),
+               STORE_STR(&store, place_names, idx),
+               STORE_PROVINCE(&store, idx),
+               STORE_CATEGORY(&store, idx),
+               store.duration_days[idx],
+               store.avg_prices[idx],
+               store.ratings[idx],
+               topk->scores[i]);
+    }
 }
 
-double calculate_score(int index) {
-    double score = 0.0;
+// ---------------- Batch mode ----------------
+// Answer every query in a file (one per line). Each thread runs the whole
+// batch over its own slice of rows with engine_topk_batch (one shared pass
+// per block of queries) into private heaps, which are merged afterwards.
+int run_batch(const char* query_file, int num_threads) {
+    QueryBatch batch;
+    if (query_batch_load(&batch, query_file, &store) != 0) {
+        printf("Error: Cannot read query file %s\n", query_file);
+        return 1;
+    }
+    int nq = batch.count > 0 ? batch.count : 1;
+    for (int i = 0; i < batch.count; i++) {
+        Query* q = &batch.queries[i];
+        if (q->topk < 1) q->topk = 1;
+        if (q->topk > MAX_TOPK) q->topk = MAX_TOPK;
+    }
+
+    // Heaps and match counts per (thread, query)
+    TopK* tops = (TopK*)calloc((size_t)num_threads * nq, sizeof(TopK));
+    int* matched = (int*)calloc((size_t)num_threads * nq, sizeof(int));
+    if (tops == NULL || matched == NULL) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < batch.count; i++) {
+            if (topk_init(&tops[t * nq + i], batch.queries[i].topk) != 0) {
+                printf("Error: Out of memory\n");
+                return 1;
+            }
+        }
+    }
+    printf("Batch: %d queries from %s\n", batch.count, query_file);
+    printf("Using %d OpenMP threads.\n", num_threads);
 
-    score += 50.0 * ratings[index];
-    score += 10.0 * popularity_scores[index];
-    score += 5.0 * log(reviews_counts[index] + 1.0);
+    omp_set_num_threads(num_threads);
+    double t0 = omp_get_wtime();
 
-    if (query_budget_max < 1000000.0) {
-        double budget_diff = fabs(avg_prices[index] - query_budget_max);
-        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
-        score += budget_closeness;
+    #pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+        int begin = (int)((long long)t * store.count / threads);
+        int end = (int)((long long)(t + 1) * store.count / threads);
+        engine_topk_batch(&store, &store_index, batch.queries, batch.count, begin, end,
+                          &tops[t * nq], &matched[t * nq]);
     }
 
-    if (query_days > 0) {
-        int duration_diff = abs(duration_days[index] - query_days);
-        double duration_closeness = 50.0 / (1.0 + duration_diff);
-        score += duration_closeness;
+    // Merge thread heaps into thread 0's
+    for (int t = 1; t < num_threads; t++) {
+        for (int i = 0; i < batch.count; i++) {
+            topk_merge(&tops[i], &tops[t * nq + i]);
+            matched[i] += matched[t * nq + i];
+        }
     }
 
-    return score;
-}
+    double t1 = omp_get_wtime();
 
-// Bubble sort (descending by score)
-void sort_topk(int* indices, double* scores, int count) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (scores[j] < scores[j + 1]) {
-                double ts = scores[j];
-                scores[j] = scores[j + 1];
-                scores[j + 1] = ts;
-
-                int ti = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = ti;
-            }
+    for (int i = 0; i < batch.count; i++) {
+        printf("\n[%d] Query: %s\n", i + 1, batch.texts[i]);
+        printf("Found %d matching packages.\n", matched[i]);
+        print_recommendations(&tops[i], topk_sort(&tops[i]));
+    }
+
+    printf("\nExecution Time (OpenMP batch of %d queries, %d threads): %.4f seconds", batch.count, num_threads, (t1 - t0));
+    if (t1 > t0) printf(" (%.0f queries/sec)", batch.count / (t1 - t0));
+    printf("\n");
+
+    for (int t = 0; t < num_threads; t++) {
+        for (int i = 0; i < batch.count; i++) {
+            topk_free(&tops[t * nq + i]);
         }
     }
+    free(tops);
+    free(matched);
+    query_batch_free(&batch);
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <dataset_file> <num_threads> [query_string]\n", argv[0]);
+        printf("Usage: %s <dataset_file> <num_threads> [--numa | --numa-bench] [query_string | --batch <query_file>]\n", argv[0]);
         printf("Example: %s package_dataset_pakistan.txt 4 \"PROVINCE=Punjab;TOPK=3\"\n", argv[0]);
         printf("Or:      %s package_dataset_pakistan.txt 4 3   (means TOPK=3)\n", argv[0]);
         printf("If no query_string, it will ask you in terminal.\n");
+        printf("--batch answers every query in query_file (one per line) in one pass\n");
+        printf("--numa places the scanned columns on the threads' NUMA nodes and pins the threads\n");
+        printf("--numa-bench times the query with and without that layout\n");
         return 1;
     }
 
@@ -172,33 +257,61 @@ int main(int argc, char* argv[]) {
     int num_threads = atoi(argv[2]);
     if (num_threads < 1) num_threads = 1;
 
-    // Load dataset
-    FILE* file = fopen(dataset_file, "r");
-    if (file == NULL) {
+    // Load dataset (snapshot if fresh, else file chunks parsed on num_threads threads)
+    printf("Loading dataset from %s...\n", dataset_file);
+    if (snapshot_load_dataset(&store, dataset_file, num_threads) != 0) {
         printf("Error: Cannot open file %s\n", dataset_file);
         return 1;
     }
+    printf("Loaded %d packages.\n", store.count);
+    if (index_build(&store_index, &store) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
 
-    char line[MAX_LINE_LENGTH];
-    total_packages = 0;
+    // Optional layout flag before the query
+    int numa = 0;
+    int numa_bench = 0;
+    int query_arg = 3;
+    if (argc >= 4 && strcmp(argv[3], "--numa") == 0) {
+        numa = 1;
+        query_arg = 4;
+    } else if (argc >= 4 && strcmp(argv[3], "--numa-bench") == 0) {
+        numa_bench = 1;
+        query_arg = 4;
+    }
 
-    printf("Loading dataset from %s...\n", dataset_file);
-    while (fgets(line, MAX_LINE_LENGTH, file) != NULL && total_packages < MAX_PACKAGES) {
-        char line_copy[MAX_LINE_LENGTH];
-        strcpy(line_copy, line);
-        if (parse_line(line_copy, total_packages)) {
-            total_packages++;
+    // With --numa, move each thread's rows to its node and pin it there
+    omp_set_num_threads(num_threads);
+    NumaTopology topo;
+    NumaPlacement placement;
+    memset(&placement, 0, sizeof(placement));
+    if (numa) {
+        numa_topology(&topo);
+        if (numa_place_store(&store, &topo, num_threads, &placement) != 0) {
+            printf("Error: Cannot place the store on NUMA nodes\n");
+            return 1;
+        }
+        pin_threads(&topo);
+    }
+
+    if (argc > query_arg && strcmp(argv[query_arg], "--batch") == 0) {
+        if (argc <= query_arg + 1) {
+            printf("Error: --batch needs a query file\n");
+            return 1;
         }
+        int status = run_batch(argv[query_arg + 1], num_threads);
+        numa_unplace(&store, &placement);
+        index_free(&store_index);
+        store_free(&store);
+        return status;
     }
-    fclose(file);
-    printf("Loaded %d packages.\n", total_packages);
 
     // Read query (argv OR stdin)
     char query_str[1024];
-    char query_original[1024];
 
-    if (argc >= 4) {
-        strncpy(query_str, argv[3], sizeof(query_str) - 1);
+    if (argc > query_arg) {
+        strncpy(query_str, argv[query_arg], sizeof(query_str) - 1);
         query_str[sizeof(query_str) - 1] = '\0';
     } else {
         printf("\nEnter query (example: TOPK=3 or PROVINCE=Punjab;CATEGORY=Nature;TOPK=3)\n");
@@ -212,78 +325,67 @@ int main(int argc, char* argv[]) {
         if (strlen(query_str) == 0) strcpy(query_str, "TOPK=5");
     }
 
-    strncpy(query_original, query_str, sizeof(query_original) - 1);
-    query_original[sizeof(query_original) - 1] = '\0';
-
-    // parse_query modifies the string (strtok)
-    char query_copy[1024];
-    strncpy(query_copy, query_str, sizeof(query_copy) - 1);
-    query_copy[sizeof(query_copy) - 1] = '\0';
-    parse_query(query_copy);
+    // Parse into a query object (query_str is left intact)
+    Query q;
+    query_parse(&q, query_str, &store);
+    if (q.topk < 1) q.topk = 1;
+    if (q.topk > MAX_TOPK) q.topk = MAX_TOPK;
+
+    if (numa_bench) {
+        int status = run_numa_bench(&q, num_threads);
+        index_free(&store_index);
+        store_free(&store);
+        return status;
+    }
 
-    printf("\nQuery: %s\n", query_original);
+    printf("\nQuery: %s\n", query_str);
     printf("Using %d OpenMP threads.\n", num_threads);
     printf("Filters: Province=%s, Category=%s, Budget=[%.0f-%.0f], Days=%d, MinRating=%.1f, TopK=%d\n\n",
-           strlen(query_province) > 0 ? query_province : "ANY",
-           strlen(query_category) > 0 ? query_category : "ANY",
-           query_budget_min, query_budget_max,
-           query_days > 0 ? query_days : -1,
-           query_min_rating, query_topk);
+           strlen(q.province) > 0 ? q.province : "ANY",
+           strlen(q.category) > 0 ? q.category : "ANY",
+           q.budget_min, q.budget_max,
+           q.days > 0 ? q.days : -1,
+           q.min_rating, q.topk);
 
     // Timing start
-    omp_set_num_threads(num_threads);
     double t0 = omp_get_wtime();
 
-    // Parallel filter + score
-    int global_indices[MAX_PACKAGES];
-    double global_scores[MAX_PACKAGES];
-    int global_count = 0;
-
-    #pragma omp parallel for schedule(static)
-    for (int i = 0; i < total_packages; i++) {
-        if (matches_filter(i)) {
-            double sc = calculate_score(i);
-
-            int pos;
-            #pragma omp atomic capture
-            pos = global_count++;
-
-            if (pos < MAX_PACKAGES) {
-                global_indices[pos] = i;
-                global_scores[pos] = sc;
-            }
-        }
+    TopK topk;
+    double* busy = (double*)calloc(num_threads, sizeof(double));
+    long long* rows = (long long*)calloc(num_threads, sizeof(long long));
+    if (busy == NULL || rows == NULL || topk_init(&topk, q.topk) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
     }
+    int match_count = run_query(&q, &topk, busy, rows);
 
-    // Clamp just in case (should not exceed MAX_PACKAGES anyway)
-    if (global_count > MAX_PACKAGES) global_count = MAX_PACKAGES;
+    printf("Found %d matching packages.\n", match_count);
 
-    printf("Found %d matching packages.\n", global_count);
-
-    if (global_count > 0) {
-        sort_topk(global_indices, global_scores, global_count);
-        int topk_count = (global_count < query_topk) ? global_count : query_topk;
+    if (match_count > 0) {
+        // Ties are broken by package index, so the result does not depend
+        // on the order the thread heaps were combined
+        int topk_count = topk_sort(&topk);
 
         printf("\n==== FINAL TOP %d Recommendations (OpenMP) ====\n", topk_count);
-        for (int i = 0; i < topk_count; i++) {
-            int idx = global_indices[i];
-            printf("%d. %s | %s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
-                   i + 1,
-                   package_ids[idx],
-                   place_names[idx],
-                   provinces[idx],
-                   categories[idx],
-                   duration_days[idx],
-                   avg_prices[idx],
-                   ratings[idx],
-                   global_scores[i]);
-        }
+        print_recommendations(&topk, topk_count);
     } else {
         printf("No packages match the query filters.\n");
     }
 
+    if (numa) {
+        printf("\n==== NUMA Layout (nodes: %d) ====\n", topo.num_nodes);
+        numa_print_bandwidth(&topo, num_threads, rows, busy);
+    }
+
     double t1 = omp_get_wtime();
     printf("\nExecution Time (OpenMP with %d threads): %.4f seconds\n", num_threads, (t1 - t0));
 
+    topk_free(&topk);
+    free(busy);
+    free(rows);
+    numa_unplace(&store, &placement);
+    index_free(&store_index);
+    store_free(&store);
+
     return 0;
 }
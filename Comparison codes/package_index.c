@@ -0,0 +1,211 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "package_index.h"
+
+void index_init(PackageIndex* idx) {
+    memset(idx, 0, sizeof(*idx));
+}
+
+static void posting_free(PostingIndex* p) {
+    free(p->offsets);
+    free(p->rows);
+    memset(p, 0, sizeof(*p));
+}
+
+static void range_free(RangeIndex* r) {
+    free(r->values);
+    free(r->rows);
+    memset(r, 0, sizeof(*r));
+}
+
+void index_free(PackageIndex* idx) {
+    posting_free(&idx->province);
+    posting_free(&idx->category);
+    posting_free(&idx->duration);
+    range_free(&idx->price);
+    range_free(&idx->rating);
+}
+
+// Counting sort of row ids by value. value_of(s, row) returns the row's
+// value, or -1 to leave the row out. Rows are visited in order, so every
+// list comes out ascending.
+static int posting_build(PostingIndex* p, const PackageStore* s, int num_values,
+                         int (*value_of)(const PackageStore*, int)) {
+    p->num_values = num_values;
+    p->offsets = (int*)calloc(num_values + 1, sizeof(int));
+    p->rows = (int*)malloc((s->count > 0 ? s->count : 1) * sizeof(int));
+    if (p->offsets == NULL || p->rows == NULL) return -1;
+
+    for (int r = 0; r < s->count; r++) {
+        int v = value_of(s, r);
+        if (v >= 0) p->offsets[v + 1]++;
+    }
+    for (int v = 0; v < num_values; v++) {
+        p->offsets[v + 1] += p->offsets[v];
+    }
+
+    int* next = (int*)malloc((num_values > 0 ? num_values : 1) * sizeof(int));
+    if (next == NULL) return -1;
+    memcpy(next, p->offsets, num_values * sizeof(int));
+    for (int r = 0; r < s->count; r++) {
+        int v = value_of(s, r);
+        if (v >= 0) p->rows[next[v]++] = r;
+    }
+    free(next);
+    return 0;
+}
+
+static int province_of(const PackageStore* s, int row) {
+    return s->province_codes[row];
+}
+
+static int category_of(const PackageStore* s, int row) {
+    return s->category_codes[row];
+}
+
+static int duration_of(const PackageStore* s, int row) {
+    int days = s->duration_days[row];
+    return (days >= 0 && days < INDEX_MAX_DAYS) ? days : -1;
+}
+
+// Map a double to an unsigned key with the same order (for non-NaN values)
+static uint64_t order_key(double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    return (bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL);
+}
+
+// Sort the rows of a numeric column by value with an LSD radix sort on the
+// order-preserving keys, one byte per pass. The sort is stable, so equal
+// values keep row order. Passes where every key has the same byte are
+// skipped (prices and ratings share most of their high bytes).
+static int range_build(RangeIndex* r, const double* column, int n) {
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < n; i++) {
+        if (isnan(column[i])) return 0;   // leave the column unindexed
+    }
+    if (n == 0) return 0;
+
+    uint64_t* keys = (uint64_t*)malloc(n * sizeof(uint64_t));
+    uint64_t* keys_tmp = (uint64_t*)malloc(n * sizeof(uint64_t));
+    int* rows = (int*)malloc(n * sizeof(int));
+    int* rows_tmp = (int*)malloc(n * sizeof(int));
+    r->values = (double*)malloc(n * sizeof(double));
+    if (keys == NULL || keys_tmp == NULL || rows == NULL || rows_tmp == NULL || r->values == NULL) {
+        free(keys);
+        free(keys_tmp);
+        free(rows);
+        free(rows_tmp);
+        range_free(r);
+        return -1;
+    }
+
+    int counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (int i = 0; i < n; i++) {
+        keys[i] = order_key(column[i]);
+        rows[i] = i;
+        for (int b = 0; b < 8; b++) counts[b][(keys[i] >> (8 * b)) & 0xFF]++;
+    }
+
+    for (int b = 0; b < 8; b++) {
+        int* count = counts[b];
+        if (count[(keys[0] >> (8 * b)) & 0xFF] == n) continue;
+
+        int pos = 0;
+        for (int v = 0; v < 256; v++) {
+            int c = count[v];
+            count[v] = pos;
+            pos += c;
+        }
+        for (int i = 0; i < n; i++) {
+            int dst = count[(keys[i] >> (8 * b)) & 0xFF]++;
+            keys_tmp[dst] = keys[i];
+            rows_tmp[dst] = rows[i];
+        }
+
+        uint64_t* k = keys; keys = keys_tmp; keys_tmp = k;
+        int* t = rows; rows = rows_tmp; rows_tmp = t;
+    }
+
+    for (int i = 0; i < n; i++) {
+        r->values[i] = column[rows[i]];
+    }
+    r->rows = rows;
+    r->count = n;
+
+    free(keys);
+    free(keys_tmp);
+    free(rows_tmp);
+    return 0;
+}
+
+int index_build(PackageIndex* idx, const PackageStore* s) {
+    index_init(idx);
+
+    int max_days = -1;
+    for (int r = 0; r < s->count; r++) {
+        int days = duration_of(s, r);
+        if (days > max_days) max_days = days;
+    }
+
+    if (posting_build(&idx->province, s, s->province_dict.count, province_of) != 0 ||
+        posting_build(&idx->category, s, s->category_dict.count, category_of) != 0 ||
+        posting_build(&idx->duration, s, max_days + 1, duration_of) != 0 ||
+        range_build(&idx->price, s->avg_prices, s->count) != 0 ||
+        range_build(&idx->rating, s->ratings, s->count) != 0) {
+        index_free(idx);
+        return -1;
+    }
+    return 0;
+}
+
+// First position in rows[0..n) holding a row id >= row
+static int lower_bound(const int* rows, int n, int row) {
+    int lo = 0;
+    int hi = n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (rows[mid] < row) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+int posting_range(const PostingIndex* p, int value, int begin, int end, const int** rows) {
+    if (value < 0 || value >= p->num_values) return -1;
+
+    const int* list = p->rows + p->offsets[value];
+    int n = p->offsets[value + 1] - p->offsets[value];
+    int first = lower_bound(list, n, begin);
+    int last = lower_bound(list, n, end);
+
+    *rows = list + first;
+    return last - first;
+}
+
+int range_window(const RangeIndex* r, double min, double max, const int** rows) {
+    if (r->count == 0) return -1;
+
+    // First value that is not < min, first value that is > max
+    int lo = 0;
+    int hi = r->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (r->values[mid] < min) lo = mid + 1;
+        else hi = mid;
+    }
+    int first = lo;
+
+    hi = r->count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (r->values[mid] > max) hi = mid;
+        else lo = mid + 1;
+    }
+
+    *rows = r->rows + first;
+    return lo - first;
+}
@@ -0,0 +1,58 @@
+#ifndef PACKAGE_INDEX_H
+#define PACKAGE_INDEX_H
+
+#include "package_store.h"
+
+// Secondary indexes over a loaded PackageStore.
+//
+// For province, category and duration_days every value has a posting list:
+// the ascending row ids holding that value. The lists of one column are
+// stored back to back in a single array, with offsets[v]..offsets[v + 1]
+// delimiting value v (built with one counting pass, no per-list
+// allocation). Durations outside [0, INDEX_MAX_DAYS) are not indexed, and
+// queries for them fall back to a scan.
+//
+// For the range columns (avg_price, rating) the row ids are kept sorted by
+// value, next to the sorted values, so the rows inside a [min, max] window
+// are found with two binary searches. A column holding a NaN is not
+// indexed: the filter lets NaN through every range test, which no sorted
+// order can express.
+
+#define INDEX_MAX_DAYS 1024
+
+typedef struct {
+    int num_values;   // values with a list (codes or day counts)
+    int* offsets;     // num_values + 1 entries
+    int* rows;        // ascending row ids, grouped by value
+} PostingIndex;
+
+typedef struct {
+    int count;        // rows indexed; 0 when the column is not indexed
+    double* values;   // ascending (ties in row order)
+    int* rows;        // row id of each value
+} RangeIndex;
+
+typedef struct {
+    PostingIndex province;
+    PostingIndex category;
+    PostingIndex duration;
+    RangeIndex price;
+    RangeIndex rating;
+} PackageIndex;
+
+void index_init(PackageIndex* idx);
+void index_free(PackageIndex* idx);
+
+// Build every index over the rows of s. 0 or -1 (out of memory).
+int index_build(PackageIndex* idx, const PackageStore* s);
+
+// Rows in [begin, end) with the given value: sets *rows and returns the
+// count. -1 if the value has no list (e.g. an unindexed duration).
+int posting_range(const PostingIndex* p, int value, int begin, int end, const int** rows);
+
+// Rows whose value v satisfies !(v < min) && !(v > max), i.e. what the
+// filter's range tests accept: sets *rows (in value order, not row order)
+// and returns the count. -1 if the column is not indexed.
+int range_window(const RangeIndex* r, double min, double max, const int** rows);
+
+#endif
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "package_store.h"
+
+#define LAST_USED_FIELD 14   // popularity_score; later columns are not loaded
+#define MAX_NUMBER_LENGTH 64
+#define HEADER_PREFIX "package_id"
+#define HEADER_PREFIX_LEN 10
+#define MIN_CHUNK_BYTES (256 * 1024)
+#define INITIAL_ROWS 1024
+#define INITIAL_TEXT (64 * 1024)
+
+void store_init(PackageStore* s) {
+    memset(s, 0, sizeof(*s));
+}
+
+void store_free(PackageStore* s) {
+    if (s->snapshot_map != NULL) {
+        dict_free(&s->province_dict);
+        dict_free(&s->category_dict);
+        munmap(s->snapshot_map, s->snapshot_size);
+        store_init(s);
+        return;
+    }
+
+    free(s->package_ids);
+    free(s->place_names);
+    free(s->province_codes);
+    free(s->category_codes);
+    dict_free(&s->province_dict);
+    dict_free(&s->category_dict);
+    free(s->duration_days);
+    free(s->avg_prices);
+    free(s->ratings);
+    free(s->reviews_counts);
+    free(s->popularity_scores);
+    free(s->base_scores);
+    if (s->text_mapped) munmap(s->text, s->text_len);
+    else free(s->text);
+    store_init(s);
+}
+
+// realloc one column; leaves *column untouched on failure
+static int grow_column(void** column, size_t elem_size, int rows) {
+    void* p = realloc(*column, (size_t)rows * elem_size);
+    if (p == NULL) return -1;
+    *column = p;
+    return 0;
+}
+
+int store_reserve(PackageStore* s, int rows) {
+    if (rows <= s->capacity) return 0;
+    if (s->snapshot_map != NULL) return -1;   // read-only columns
+
+    int new_capacity = (s->capacity > 0) ? s->capacity : INITIAL_ROWS;
+    while (new_capacity < rows) new_capacity *= 2;
+
+    if (grow_column((void**)&s->package_ids, sizeof(StrRef), new_capacity) != 0 ||
+        grow_column((void**)&s->place_names, sizeof(StrRef), new_capacity) != 0 ||
+        grow_column((void**)&s->province_codes, sizeof(unsigned char), new_capacity) != 0 ||
+        grow_column((void**)&s->category_codes, sizeof(unsigned char), new_capacity) != 0 ||
+        grow_column((void**)&s->duration_days, sizeof(int), new_capacity) != 0 ||
+        grow_column((void**)&s->avg_prices, sizeof(double), new_capacity) != 0 ||
+        grow_column((void**)&s->ratings, sizeof(double), new_capacity) != 0 ||
+        grow_column((void**)&s->reviews_counts, sizeof(int), new_capacity) != 0 ||
+        grow_column((void**)&s->popularity_scores, sizeof(double), new_capacity) != 0 ||
+        grow_column((void**)&s->base_scores, sizeof(double), new_capacity) != 0) {
+        return -1;
+    }
+
+    s->capacity = new_capacity;
+    return 0;
+}
+
+double store_base_score(double rating, double popularity, int reviews_count) {
+    double score = 0.0;
+    score += 50.0 * rating;
+    score += 10.0 * popularity;
+    score += 5.0 * log(reviews_count + 1.0);
+    return score;
+}
+
+void store_refresh_base_score(PackageStore* s, int row) {
+    s->base_scores[row] = store_base_score(s->ratings[row], s->popularity_scores[row],
+                                           s->reviews_counts[row]);
+}
+
+int store_reserve_text(PackageStore* s, size_t bytes) {
+    if (s->text_mapped) return -1;
+    if (bytes <= s->text_capacity) return 0;
+
+    size_t new_capacity = (s->text_capacity > 0) ? s->text_capacity : INITIAL_TEXT;
+    while (new_capacity < bytes) new_capacity *= 2;
+
+    char* p = (char*)realloc(s->text, new_capacity);
+    if (p == NULL) return -1;
+    s->text = p;
+    s->text_capacity = new_capacity;
+    return 0;
+}
+
+// Intern a field into a dictionary column
+static int intern_field(StringDict* d, const char* value, int length, unsigned char* code) {
+    int c = dict_intern(d, value, length);
+    if (c < 0) return -1;
+    *code = (unsigned char)c;
+    return 0;
+}
+
+// atof/atoi need a NUL-terminated string; fields in the mapping end at a TAB
+static double field_to_double(const char* field, int length) {
+    char buf[MAX_NUMBER_LENGTH];
+    if (length >= MAX_NUMBER_LENGTH) length = MAX_NUMBER_LENGTH - 1;
+    memcpy(buf, field, length);
+    buf[length] = '\0';
+    return atof(buf);
+}
+
+static int field_to_int(const char* field, int length) {
+    char buf[MAX_NUMBER_LENGTH];
+    if (length >= MAX_NUMBER_LENGTH) length = MAX_NUMBER_LENGTH - 1;
+    memcpy(buf, field, length);
+    buf[length] = '\0';
+    return atoi(buf);
+}
+
+// Parse the line text[begin..end) (newline excluded) into row s->count.
+// Returns 0 on success, -1 on error.
+static int parse_line(PackageStore* s, size_t begin, size_t end) {
+    const char* text = s->text;
+    int row = s->count;
+
+    if (store_reserve(s, row + 1) != 0) return -1;
+
+    StrRef empty = { begin, 0 };
+    s->package_ids[row] = empty;
+    s->place_names[row] = empty;
+    s->duration_days[row] = 0;
+    s->avg_prices[row] = 0.0;
+    s->ratings[row] = 0.0;
+    s->reviews_counts[row] = 0;
+    s->popularity_scores[row] = 0.0;
+
+    int field_index = 0;
+    size_t pos = begin;
+
+    for (; field_index <= LAST_USED_FIELD; field_index++) {
+        const char* tab = (const char*)memchr(text + pos, '\t', end - pos);
+        size_t field_end = (tab != NULL) ? (size_t)(tab - text) : end;
+        const char* field = text + pos;
+        int length = (int)(field_end - pos);
+
+        // Extract fields based on column index; strings stay in the mapping
+        int rc = 0;
+        if (field_index == 0) s->package_ids[row] = (StrRef){ pos, length };
+        else if (field_index == 1) s->place_names[row] = (StrRef){ pos, length };
+        else if (field_index == 2) rc = intern_field(&s->province_dict, field, length, &s->province_codes[row]);
+        else if (field_index == 5) rc = intern_field(&s->category_dict, field, length, &s->category_codes[row]);
+        else if (field_index == 6) s->duration_days[row] = field_to_int(field, length);
+        else if (field_index == 8) s->avg_prices[row] = field_to_double(field, length);
+        else if (field_index == 12) s->ratings[row] = field_to_double(field, length);
+        else if (field_index == 13) s->reviews_counts[row] = field_to_int(field, length);
+        else if (field_index == 14) s->popularity_scores[row] = field_to_double(field, length);
+        if (rc != 0) return -1;
+
+        if (tab == NULL) break;
+        pos = field_end + 1;
+    }
+
+    // Short line: missing dictionary fields read as ""
+    if (field_index < 2 && intern_field(&s->province_dict, "", 0, &s->province_codes[row]) != 0) return -1;
+    if (field_index < 5 && intern_field(&s->category_dict, "", 0, &s->category_codes[row]) != 0) return -1;
+
+    store_refresh_base_score(s, row);
+    s->count++;
+    return 0;
+}
+
+// Parse every line in text[begin..end)
+static int parse_lines(PackageStore* s, size_t begin, size_t end) {
+    const char* text = s->text;
+    size_t pos = begin;
+
+    while (pos < end) {
+        const char* nl = (const char*)memchr(text + pos, '\n', end - pos);
+        size_t line_end = (nl != NULL) ? (size_t)(nl - text) : end;
+        size_t next = line_end + 1;
+
+        if (line_end > pos && text[line_end - 1] == '\r') line_end--;
+        if (line_end > pos && parse_line(s, pos, line_end) != 0) return -1;
+
+        pos = next;
+    }
+    return 0;
+}
+
+// One newline-aligned byte range of the mapping and the rows parsed from it
+typedef struct {
+    PackageStore rows;    // chunk-local columns; text borrowed from the mapping
+    size_t begin;
+    size_t end;
+    int status;
+} LoadChunk;
+
+static void* parse_chunk(void* arg) {
+    LoadChunk* c = (LoadChunk*)arg;
+    c->status = parse_lines(&c->rows, c->begin, c->end);
+    return NULL;
+}
+
+// First byte of the line after the one containing pos (or size)
+static size_t next_line_start(const char* text, size_t pos, size_t size) {
+    if (pos == 0 || pos >= size) return (pos >= size) ? size : 0;
+    if (text[pos - 1] == '\n') return pos;
+
+    const char* nl = (const char*)memchr(text + pos, '\n', size - pos);
+    return (nl != NULL) ? (size_t)(nl - text) + 1 : size;
+}
+
+// Append a chunk's rows in order, translating its dictionary codes. Chunks
+// are appended in file order, so codes come out as for a sequential load.
+static int append_chunk(PackageStore* s, const PackageStore* c) {
+    unsigned char province_map[DICT_MAX_VALUES];
+    unsigned char category_map[DICT_MAX_VALUES];
+
+    for (int i = 0; i < c->province_dict.count; i++) {
+        if (intern_field(&s->province_dict, c->province_dict.values[i],
+                         c->province_dict.lengths[i], &province_map[i]) != 0) return -1;
+    }
+    for (int i = 0; i < c->category_dict.count; i++) {
+        if (intern_field(&s->category_dict, c->category_dict.values[i],
+                         c->category_dict.lengths[i], &category_map[i]) != 0) return -1;
+    }
+
+    int base = s->count;
+    int n = c->count;
+    if (store_reserve(s, base + n) != 0) return -1;
+
+    // String views are offsets into the shared mapping and copy as-is
+    memcpy(s->package_ids + base, c->package_ids, n * sizeof(StrRef));
+    memcpy(s->place_names + base, c->place_names, n * sizeof(StrRef));
+    memcpy(s->duration_days + base, c->duration_days, n * sizeof(int));
+    memcpy(s->avg_prices + base, c->avg_prices, n * sizeof(double));
+    memcpy(s->ratings + base, c->ratings, n * sizeof(double));
+    memcpy(s->reviews_counts + base, c->reviews_counts, n * sizeof(int));
+    memcpy(s->popularity_scores + base, c->popularity_scores, n * sizeof(double));
+    memcpy(s->base_scores + base, c->base_scores, n * sizeof(double));
+    for (int r = 0; r < n; r++) {
+        s->province_codes[base + r] = province_map[c->province_codes[r]];
+        s->category_codes[base + r] = category_map[c->category_codes[r]];
+    }
+
+    s->count += n;
+    return 0;
+}
+
+// Offset of the first row: past the header line, if text starts with one
+static size_t skip_header(const char* text, size_t size) {
+    if (size < HEADER_PREFIX_LEN || memcmp(text, HEADER_PREFIX, HEADER_PREFIX_LEN) != 0) return 0;
+    const char* nl = (const char*)memchr(text, '\n', size);
+    return (nl != NULL) ? (size_t)(nl - text) + 1 : size;
+}
+
+// Parse s->text into s, on up to num_threads threads
+static int parse_text(PackageStore* s, int num_threads) {
+    char* map = s->text;
+    size_t size = s->text_len;
+    size_t begin = skip_header(map, size);
+
+    // Small files are not worth the thread start-up
+    size_t body = size - begin;
+    int num_chunks = (num_threads > 1) ? num_threads : 1;
+    if ((size_t)num_chunks > body / MIN_CHUNK_BYTES) num_chunks = (int)(body / MIN_CHUNK_BYTES);
+    if (num_chunks <= 1) return parse_lines(s, begin, size);
+
+    LoadChunk* chunks = (LoadChunk*)calloc(num_chunks, sizeof(LoadChunk));
+    pthread_t* threads = (pthread_t*)malloc(num_chunks * sizeof(pthread_t));
+    if (chunks == NULL || threads == NULL) {
+        free(chunks);
+        free(threads);
+        return -1;
+    }
+
+    // Split into equal byte ranges, each moved forward to a line start
+    for (int i = 0; i < num_chunks; i++) {
+        chunks[i].begin = (i == 0) ? begin
+                                   : next_line_start(map, begin + body * i / num_chunks, size);
+        chunks[i].rows.text = map;
+        chunks[i].rows.text_len = size;
+    }
+    for (int i = 0; i < num_chunks; i++) {
+        chunks[i].end = (i == num_chunks - 1) ? size : chunks[i + 1].begin;
+    }
+
+    int started = 0;
+    for (; started < num_chunks; started++) {
+        if (pthread_create(&threads[started], NULL, parse_chunk, &chunks[started]) != 0) break;
+    }
+    // Parse anything we could not start a thread for on this thread
+    for (int i = started; i < num_chunks; i++) {
+        parse_chunk(&chunks[i]);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int status = 0;
+    for (int i = 0; i < num_chunks; i++) {
+        if (status == 0) status = chunks[i].status;
+        if (status == 0) status = append_chunk(s, &chunks[i].rows);
+
+        chunks[i].rows.text = NULL;   // the text belongs to s
+        store_free(&chunks[i].rows);
+    }
+
+    free(chunks);
+    free(threads);
+    return status;
+}
+
+int store_load_tsv(PackageStore* s, const char* path) {
+    return store_load_tsv_parallel(s, path, 1);
+}
+
+int store_load_tsv_parallel(PackageStore* s, const char* path, int num_threads) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    if (size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    char* map = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    madvise(map, size, MADV_SEQUENTIAL);
+
+    s->text = map;
+    s->text_len = size;
+    s->text_capacity = size;
+    s->text_mapped = 1;
+    return parse_text(s, num_threads);
+}
+
+int store_load_tsv_buffer(PackageStore* s, char* text, size_t size, int num_threads) {
+    s->text = text;
+    s->text_len = size;
+    s->text_capacity = size;
+    s->text_mapped = 0;
+    return parse_text(s, num_threads);
+}
+
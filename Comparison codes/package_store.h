@@ -0,0 +1,103 @@
+#ifndef PACKAGE_STORE_H
+#define PACKAGE_STORE_H
+
+#include <stddef.h>
+#include "string_dict.h"
+
+// Structure-of-arrays package catalogue shared by all recommenders.
+//
+// Every column is a separate array indexed by package (row) number and all
+// columns grow together, so memory is proportional to the rows actually
+// loaded. String columns do not own fixed-size slots: each row holds a view
+// (offset + length) into one shared text buffer. Print them with "%.*s" and
+// STORE_STR(). When loaded from a file the text buffer is the read-only
+// memory mapping of the file itself, so string fields are never copied.
+//
+// Province and category are interned: rows hold one-byte codes into a
+// per-store dictionary (see string_dict.h).
+
+typedef struct {
+    size_t offset;    // byte offset into PackageStore.text
+    int length;
+} StrRef;
+
+typedef struct {
+    int count;        // rows loaded
+    int capacity;     // rows allocated in every column
+
+    // String columns
+    StrRef* package_ids;
+    StrRef* place_names;
+
+    // Dictionary-encoded columns
+    unsigned char* province_codes;
+    unsigned char* category_codes;
+    StringDict province_dict;
+    StringDict category_dict;
+
+    // Numeric columns
+    int* duration_days;
+    double* avg_prices;
+    double* ratings;
+    int* reviews_counts;
+    double* popularity_scores;
+
+    // Query-independent part of the recommendation score (see
+    // store_base_score); kept in step with the columns it is derived from
+    double* base_scores;
+
+    // Backing bytes for the string columns
+    char* text;
+    size_t text_len;
+    size_t text_capacity;
+    int text_mapped;  // 1: text is an mmap of the dataset (read-only)
+
+    // Set when every column lives in a mapped snapshot file (snapshot.h)
+    void* snapshot_map;
+    size_t snapshot_size;
+} PackageStore;
+
+// Expands to the (length, pointer) argument pair for a "%.*s" conversion
+#define STORE_STR(s, column, i) \
+    (s)->column[i].length, (s)->text + (s)->column[i].offset
+
+void store_init(PackageStore* s);
+void store_free(PackageStore* s);
+
+// Make room for at least `rows` rows / `bytes` bytes of text. 0 or -1.
+int store_reserve(PackageStore* s, int rows);
+int store_reserve_text(PackageStore* s, size_t bytes);
+
+// Load a TAB-delimited dataset into an empty store (header line skipped).
+// The file is memory-mapped and scanned in place. 0 on success, -1 if the
+// file cannot be opened or mapped, memory runs out, or a dictionary column
+// has more than DICT_MAX_VALUES distinct values.
+int store_load_tsv(PackageStore* s, const char* path);
+
+// Same, parsing newline-aligned byte ranges of the file on up to
+// num_threads threads and stitching them together in file order. The
+// result is identical to store_load_tsv().
+int store_load_tsv_parallel(PackageStore* s, const char* path, int num_threads);
+
+// Load the TAB-delimited lines in text[0..size) into an empty store, on up
+// to num_threads threads, like store_load_tsv_parallel(). The store takes
+// ownership of text (malloc'd; freed by store_free) and points its string
+// columns into it. A header line is skipped only if text starts with one,
+// so any newline-aligned piece of a dataset can be loaded. 0 or -1, as for
+// store_load_tsv().
+int store_load_tsv_buffer(PackageStore* s, char* text, size_t size, int num_threads);
+
+// 50*rating + 10*popularity + 5*log(reviews+1): the part of a package's
+// score that does not depend on the query. Terms are added in the same
+// order as the original per-query formula so totals match it exactly.
+double store_base_score(double rating, double popularity, int reviews_count);
+
+// Recompute base_scores[row] after changing its rating, popularity or
+// review count.
+void store_refresh_base_score(PackageStore* s, int row);
+
+// Display strings for the dictionary-encoded columns
+#define STORE_PROVINCE(s, i) dict_value(&(s)->province_dict, (s)->province_codes[i])
+#define STORE_CATEGORY(s, i) dict_value(&(s)->category_dict, (s)->category_codes[i])
+
+#endif
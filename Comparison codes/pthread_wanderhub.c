@@ -1,330 +1,362 @@
+// pthread_wanderhub.c
+// Build: gcc pthread_wanderhub.c filter_kernel.c package_index.c package_store.c query.c query_engine.c numa_layout.c snapshot.c string_dict.c topk.c work_pool.c -o pthread_wanderhub -lm -pthread
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
 #include <time.h>
 #include <pthread.h>
+#include "package_store.h"
+#include "snapshot.h"
+#include "query.h"
+#include "topk.h"
+#include "package_index.h"
+#include "query_engine.h"
+#include "work_pool.h"
+#include "numa_layout.h"
 
-#define MAX_LINE_LENGTH 2048
-#define MAX_PACKAGES 1000
-#define MAX_FIELDS 20
 #define MAX_STRING_LENGTH 256
-#define MAX_THREADS 16
+#define MAX_TOPK 1000
+#define MIN_CHUNK_ROWS 64     // rows per work-pool chunk, see chunk_rows_for()
+#define MAX_CHUNK_ROWS 4096
+#define CHUNKS_PER_THREAD 8
+#define NUMA_BENCH_RUNS 20
 
-// Global arrays to store package data (no structs)
-char package_ids[MAX_PACKAGES][32];
-char place_names[MAX_PACKAGES][256];
-char provinces[MAX_PACKAGES][128];
-char categories[MAX_PACKAGES][128];
-int duration_days[MAX_PACKAGES];
-double avg_prices[MAX_PACKAGES];
-double ratings[MAX_PACKAGES];
-int reviews_counts[MAX_PACKAGES];
-double popularity_scores[MAX_PACKAGES];
+// Package catalogue (columnar, grows with the dataset)
+PackageStore store;
+PackageIndex store_index;   // posting lists, built once the store is loaded
 
-int total_packages = 0;
+// One query over the whole store, split into chunks of chunk_rows rows.
+// Each worker keeps its own TopK and match count, merged after the job.
+typedef struct {
+    const Query* q;
+    int chunk_rows;
+    TopK* local_topk;
+    int* local_matches;
+    long long* local_rows;   // rows covered by each worker's chunks
+} QueryJob;
 
-// Query parameters (defaults: no filter)
-char query_province[128] = "";
-char query_category[128] = "";
-double query_budget_min = 0.0;
-double query_budget_max = 1000000.0;
-int query_days = -1;
-double query_min_rating = 0.0;
-int query_topk = 5;
+// Pool task: process one chunk of rows into the running worker's TOPK
+void process_chunk(void* ctx, int worker, int chunk) {
+    QueryJob* job = (QueryJob*)ctx;
+    int start = chunk * job->chunk_rows;
+    int end = (store.count - start > job->chunk_rows) ? start + job->chunk_rows : store.count;
+    
+    job->local_matches[worker] += engine_topk(&store, &store_index, job->q, start, end,
+                                              &job->local_topk[worker]);
+    job->local_rows[worker] += end - start;
+}
 
-// Thread data arrays (no structs)
-int thread_start[MAX_THREADS];
-int thread_end[MAX_THREADS];
-int local_topk_indices[MAX_THREADS][MAX_PACKAGES];
-double local_topk_scores[MAX_THREADS][MAX_PACKAGES];
-int local_topk_counts[MAX_THREADS];
+// TOPK within [1, min(MAX_TOPK, rows)]: every worker allocates a heap of
+// that size, so it must not grow with user input
+int clamp_topk(int topk) {
+    int limit = (store.count < MAX_TOPK) ? store.count : MAX_TOPK;
+    if (topk > limit) topk = limit;
+    if (topk < 1) topk = 1;
+    return topk;
+}
 
-pthread_mutex_t lock;
+// Rows per chunk: about CHUNKS_PER_THREAD chunks per thread, so an idle
+// thread has chunks to steal even on a small store, but never so small
+// that per-chunk overhead dominates nor so large that one chunk leaves the
+// cache
+int chunk_rows_for(int count, int num_threads) {
+    long long rows = count / ((long long)num_threads * CHUNKS_PER_THREAD);
+    if (rows < MIN_CHUNK_ROWS) rows = MIN_CHUNK_ROWS;
+    if (rows > MAX_CHUNK_ROWS) rows = MAX_CHUNK_ROWS;
+    if (rows > count && count > 0) rows = count;
+    return (int)rows;
+}
 
-// Function to parse a line and extract fields (TAB-delimited)
-int parse_line(char* line, int package_index) {
-    char* token;
-    int field_index = 0;
-    
-    // Skip header line
-    if (strstr(line, "package_id") != NULL) {
-        return 0;
-    }
-    
-    token = strtok(line, "\t");
-    while (token != NULL && field_index < MAX_FIELDS) {
-        char* newline = strchr(token, '\n');
-        if (newline) *newline = '\0';
-        
-        if (field_index == 0) strncpy(package_ids[package_index], token, 31);
-        else if (field_index == 1) strncpy(place_names[package_index], token, 255);
-        else if (field_index == 2) strncpy(provinces[package_index], token, 127);
-        else if (field_index == 5) strncpy(categories[package_index], token, 127);
-        else if (field_index == 6) duration_days[package_index] = atoi(token);
-        else if (field_index == 8) avg_prices[package_index] = atof(token);
-        else if (field_index == 12) ratings[package_index] = atof(token);
-        else if (field_index == 13) reviews_counts[package_index] = atoi(token);
-        else if (field_index == 14) popularity_scores[package_index] = atof(token);
-        
-        token = strtok(NULL, "\t");
-        field_index++;
-    }
-    
-    return 1;
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
 }
 
-// Function to parse query string
-void parse_query(char* query_str) {
-    strcpy(query_province, "");
-    strcpy(query_category, "");
-    query_budget_min = 0.0;
-    query_budget_max = 1000000.0;
-    query_days = -1;
-    query_min_rating = 0.0;
-    query_topk = 5;
-    
-    char* token = strtok(query_str, ";");
-    while (token != NULL) {
-        if (strncmp(token, "PROVINCE=", 9) == 0) {
-            strcpy(query_province, token + 9);
-        } else if (strncmp(token, "CATEGORY=", 9) == 0) {
-            strcpy(query_category, token + 9);
-        } else if (strncmp(token, "BUDGET_MIN=", 11) == 0) {
-            query_budget_min = atof(token + 11);
-        } else if (strncmp(token, "BUDGET_MAX=", 11) == 0) {
-            query_budget_max = atof(token + 11);
-        } else if (strncmp(token, "DAYS=", 5) == 0) {
-            query_days = atoi(token + 5);
-        } else if (strncmp(token, "MIN_RATING=", 11) == 0) {
-            query_min_rating = atof(token + 11);
-        } else if (strncmp(token, "TOPK=", 5) == 0) {
-            query_topk = atoi(token + 5);
-        }
-        token = strtok(NULL, ";");
+// CPU of every worker under the NUMA layout (see numa_layout.h)
+int* worker_cpus(const NumaTopology* topo, int num_threads) {
+    int* cpus = (int*)malloc(num_threads * sizeof(int));
+    if (cpus == NULL) return NULL;
+    for (int t = 0; t < num_threads; t++) {
+        cpus[t] = numa_worker_cpu(topo, t, num_threads);
     }
+    return cpus;
 }
 
-// Function to check if a package matches the query filters
-int matches_filter(int index) {
-    if (strlen(query_province) > 0 && strcmp(provinces[index], query_province) != 0) {
-        return 0;
-    }
-    if (strlen(query_category) > 0 && strcmp(categories[index], query_category) != 0) {
-        return 0;
+// Per-node rows and bandwidth of the pool's last job
+void print_node_bandwidth(const NumaTopology* topo, const WorkPool* pool, const QueryJob* job) {
+    double* busy = (double*)malloc(pool->num_workers * sizeof(double));
+    if (busy == NULL) return;
+    for (int t = 0; t < pool->num_workers; t++) {
+        busy[t] = pool->stats[t].busy_seconds;
     }
-    if (avg_prices[index] < query_budget_min || avg_prices[index] > query_budget_max) {
-        return 0;
-    }
-    if (query_days > 0 && duration_days[index] != query_days) {
-        return 0;
-    }
-    if (ratings[index] < query_min_rating) {
-        return 0;
-    }
-    return 1;
+    numa_print_bandwidth(topo, pool->num_workers, job->local_rows, busy);
+    free(busy);
 }
 
-// Function to calculate score for a package
-double calculate_score(int index) {
-    double score = 0.0;
-    score += 50.0 * ratings[index];
-    score += 10.0 * popularity_scores[index];
-    score += 5.0 * log(reviews_counts[index] + 1.0);
-    
-    if (query_budget_max < 1000000.0) {
-        double budget_diff = fabs(avg_prices[index] - query_budget_max);
-        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
-        score += budget_closeness;
+// ---------------- NUMA benchmark ----------------
+// Run q NUMA_BENCH_RUNS times on the store as loaded with unpinned
+// workers, then again with the scanned columns placed per node and the
+// workers pinned, and compare wall-clock times.
+int run_numa_bench(const Query* q, int num_threads) {
+    NumaTopology topo;
+    numa_topology(&topo);
+    printf("NUMA nodes: %d, CPUs available: %d\n", topo.num_nodes,
+           topo.node_first[topo.num_nodes - 1] + topo.node_cpus[topo.num_nodes - 1]);
+
+    int* cpus = worker_cpus(&topo, num_threads);
+    TopK* local_topk = (TopK*)calloc(num_threads, sizeof(TopK));
+    int* local_matches = (int*)calloc(num_threads, sizeof(int));
+    long long* local_rows = (long long*)calloc(num_threads, sizeof(long long));
+    if (cpus == NULL || local_topk == NULL || local_matches == NULL || local_rows == NULL) {
+        printf("Error: Out of memory\n");
+        return 1;
     }
-    
-    if (query_days > 0) {
-        int duration_diff = abs(duration_days[index] - query_days);
-        double duration_closeness = 50.0 / (1.0 + duration_diff);
-        score += duration_closeness;
+    for (int t = 0; t < num_threads; t++) {
+        if (topk_init(&local_topk[t], clamp_topk(q->topk)) != 0) {
+            printf("Error: Out of memory\n");
+            return 1;
+        }
     }
-    
-    return score;
-}
+    QueryJob job = { q, chunk_rows_for(store.count, num_threads), local_topk, local_matches, local_rows };
+    int num_chunks = (store.count + job.chunk_rows - 1) / job.chunk_rows;
 
-// Simple bubble sort for TOPK
-void sort_topk(int* indices, double* scores, int count) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (scores[j] < scores[j + 1]) {
-                double temp_score = scores[j];
-                scores[j] = scores[j + 1];
-                scores[j + 1] = temp_score;
-                int temp_idx = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = temp_idx;
-            }
+    double best[2] = { 0.0, 0.0 };
+    NumaPlacement placement;
+    for (int layout = 0; layout < 2; layout++) {
+        if (layout == 1 && numa_place_store(&store, &topo, num_threads, &placement) != 0) {
+            printf("Error: Cannot place the store on NUMA nodes\n");
+            return 1;
+        }
+        WorkPool pool;
+        if (pool_start(&pool, num_threads, layout == 1 ? cpus : NULL) != 0) {
+            printf("Error: Cannot start %d threads\n", num_threads);
+            return 1;
         }
-    }
-}
 
-// Thread function: process assigned range and compute local TOPK
-void* process_range(void* arg) {
-    int thread_id = *(int*)arg;
-    int start = thread_start[thread_id];
-    int end = thread_end[thread_id];
-    
-    // Local arrays for this thread's TOPK
-    int local_indices[MAX_PACKAGES];
-    double local_scores[MAX_PACKAGES];
-    int local_count = 0;
-    
-    // Process assigned range
-    for (int i = start; i < end; i++) {
-        if (matches_filter(i)) {
-            local_indices[local_count] = i;
-            local_scores[local_count] = calculate_score(i);
-            local_count++;
+        double sum = 0.0;
+        int matches = 0;
+        for (int r = 0; r < NUMA_BENCH_RUNS; r++) {
+            for (int t = 0; t < num_threads; t++) {
+                topk_reset(&local_topk[t]);
+                local_matches[t] = 0;
+                local_rows[t] = 0;
+            }
+            double t0 = now_seconds();
+            if (pool_run(&pool, num_chunks, process_chunk, &job) != 0) {
+                printf("Error: Out of memory\n");
+                return 1;
+            }
+            double elapsed = now_seconds() - t0;
+            sum += elapsed;
+            if (r == 0 || elapsed < best[layout]) best[layout] = elapsed;
+            matches = 0;
+            for (int t = 0; t < num_threads; t++) {
+                matches += local_matches[t];
+            }
         }
+
+        printf("\n==== %s ====\n", layout == 0 ? "Loaded layout, unpinned threads" : "NUMA layout, pinned threads");
+        printf("%d runs, %d matches: best %.3f ms, average %.3f ms\n",
+               NUMA_BENCH_RUNS, matches, best[layout] * 1000.0, sum / NUMA_BENCH_RUNS * 1000.0);
+        print_node_bandwidth(&topo, &pool, &job);
+        pool_stop(&pool);
     }
-    
-    // Sort local results
-    if (local_count > 0) {
-        sort_topk(local_indices, local_scores, local_count);
-    }
-    
-    // Store local TOPK (keep top query_topk or all if less)
-    int topk_count = (local_count < query_topk) ? local_count : query_topk;
-    local_topk_counts[thread_id] = topk_count;
-    
-    for (int i = 0; i < topk_count; i++) {
-        local_topk_indices[thread_id][i] = local_indices[i];
-        local_topk_scores[thread_id][i] = local_scores[i];
+    numa_unplace(&store, &placement);
+
+    if (best[1] > 0.0) printf("\nNUMA layout speedup (best run): %.2fx\n", best[0] / best[1]);
+
+    for (int t = 0; t < num_threads; t++) {
+        topk_free(&local_topk[t]);
     }
-    
-    return NULL;
+    free(local_topk);
+    free(local_matches);
+    free(local_rows);
+    free(cpus);
+    return 0;
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <dataset_file> <num_threads> [query_string]\n", argv[0]);
+        printf("Usage: %s <dataset_file> <num_threads> [--numa | --numa-bench] [query_string]\n", argv[0]);
         printf("Example: %s dataset.txt 4 PROVINCE=Punjab;CATEGORY=Nature;TOPK=5\n", argv[0]);
+        printf("--numa places the scanned columns on the workers' NUMA nodes and pins the workers\n");
+        printf("--numa-bench times the query with and without that layout\n");
         return 1;
     }
     
     int num_threads = atoi(argv[2]);
-    if (num_threads < 1 || num_threads > MAX_THREADS) {
-        printf("Error: Number of threads must be between 1 and %d\n", MAX_THREADS);
+    if (num_threads < 1) {
+        printf("Error: Number of threads must be at least 1\n");
         return 1;
     }
     
-    FILE* file = fopen(argv[1], "r");
-    if (file == NULL) {
+    // Load dataset (snapshot if fresh, else file chunks parsed on num_threads threads)
+    printf("Loading dataset from %s...\n", argv[1]);
+    if (snapshot_load_dataset(&store, argv[1], num_threads) != 0) {
         printf("Error: Cannot open file %s\n", argv[1]);
         return 1;
     }
-    
-    // Read dataset
-    char line[MAX_LINE_LENGTH];
-    printf("Loading dataset from %s...\n", argv[1]);
-    
-    while (fgets(line, MAX_LINE_LENGTH, file) != NULL && total_packages < MAX_PACKAGES) {
-        char line_copy[MAX_LINE_LENGTH];
-        strcpy(line_copy, line);
-        if (parse_line(line_copy, total_packages)) {
-            total_packages++;
-        }
+    printf("Loaded %d packages.\n", store.count);
+    if (index_build(&store_index, &store) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
     }
     
-    fclose(file);
-    printf("Loaded %d packages.\n", total_packages);
-    
-    // Parse query
-    char query_str[1024] = "";
-    if (argc >= 4) {
-        strcpy(query_str, argv[3]);
-    } else {
-        strcpy(query_str, "TOPK=5");
+    // Optional layout flag before the query
+    int numa = 0;
+    int numa_bench = 0;
+    int query_arg = 3;
+    if (argc >= 4 && strcmp(argv[3], "--numa") == 0) {
+        numa = 1;
+        query_arg = 4;
+    } else if (argc >= 4 && strcmp(argv[3], "--numa-bench") == 0) {
+        numa_bench = 1;
+        query_arg = 4;
     }
     
-    parse_query(query_str);
+    // Parse query (the string is not modified)
+    const char* query_str = (argc > query_arg) ? argv[query_arg] : "TOPK=5";
+    Query q;
+    query_parse(&q, query_str, &store);
+    q.topk = clamp_topk(q.topk);
+    
     printf("\nQuery: %s\n", query_str);
     printf("Using %d threads.\n", num_threads);
     printf("Filters: Province=%s, Category=%s, Budget=[%.0f-%.0f], Days=%d, MinRating=%.1f, TopK=%d\n\n",
-           strlen(query_province) > 0 ? query_province : "ANY",
-           strlen(query_category) > 0 ? query_category : "ANY",
-           query_budget_min, query_budget_max,
-           query_days > 0 ? query_days : -1,
-           query_min_rating, query_topk);
+           strlen(q.province) > 0 ? q.province : "ANY",
+           strlen(q.category) > 0 ? q.category : "ANY",
+           q.budget_min, q.budget_max,
+           q.days > 0 ? q.days : -1,
+           q.min_rating, q.topk);
     
-    // Initialize mutex
-    pthread_mutex_init(&lock, NULL);
+    if (numa_bench) {
+        int status = run_numa_bench(&q, num_threads);
+        index_free(&store_index);
+        store_free(&store);
+        return status;
+    }
     
-    // Start timing
-    clock_t start = clock();
+    // With --numa, move each worker's rows to its node before pinning it there
+    NumaTopology topo;
+    NumaPlacement placement;
+    int* cpus = NULL;
+    memset(&placement, 0, sizeof(placement));
+    if (numa) {
+        numa_topology(&topo);
+        cpus = worker_cpus(&topo, num_threads);
+        if (cpus == NULL || numa_place_store(&store, &topo, num_threads, &placement) != 0) {
+            printf("Error: Cannot place the store on NUMA nodes\n");
+            return 1;
+        }
+    }
     
-    // Divide work among threads
-    int chunk_size = total_packages / num_threads;
-    for (int i = 0; i < num_threads; i++) {
-        thread_start[i] = i * chunk_size;
-        thread_end[i] = (i == num_threads - 1) ? total_packages : (i + 1) * chunk_size;
-        local_topk_counts[i] = 0;
+    // Start the worker pool (threads stay up between jobs)
+    WorkPool pool;
+    if (pool_start(&pool, num_threads, cpus) != 0) {
+        printf("Error: Cannot start %d threads\n", num_threads);
+        return 1;
     }
     
-    // Create threads
-    pthread_t threads[MAX_THREADS];
-    int thread_ids[MAX_THREADS];
+    // Start timing
+    clock_t start = clock();
     
+    // Per-thread TOPK and match counts
+    TopK* local_topk = (TopK*)calloc(num_threads, sizeof(TopK));
+    int* local_matches = (int*)calloc(num_threads, sizeof(int));
+    long long* local_rows = (long long*)calloc(num_threads, sizeof(long long));
+    if (local_topk == NULL || local_matches == NULL || local_rows == NULL) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
     for (int i = 0; i < num_threads; i++) {
-        thread_ids[i] = i;
-        pthread_create(&threads[i], NULL, process_range, &thread_ids[i]);
+        if (topk_init(&local_topk[i], q.topk) != 0) {
+            printf("Error: Out of memory\n");
+            return 1;
+        }
     }
     
-    // Wait for all threads
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(threads[i], NULL);
+    // Split the rows into small chunks; idle threads steal chunks from busy ones
+    QueryJob job = { &q, chunk_rows_for(store.count, num_threads), local_topk, local_matches, local_rows };
+    int num_chunks = (store.count + job.chunk_rows - 1) / job.chunk_rows;
+    if (pool_run(&pool, num_chunks, process_chunk, &job) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
     }
     
     // Merge local TOPK results into global TOPK
-    int global_indices[MAX_PACKAGES];
-    double global_scores[MAX_PACKAGES];
-    int global_count = 0;
+    TopK global_topk;
+    if (topk_init(&global_topk, q.topk) != 0) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
     
-    // Collect all local TOPK results
     for (int t = 0; t < num_threads; t++) {
-        for (int i = 0; i < local_topk_counts[t]; i++) {
-            global_indices[global_count] = local_topk_indices[t][i];
-            global_scores[global_count] = local_topk_scores[t][i];
-            global_count++;
-        }
+        topk_merge(&global_topk, &local_topk[t]);
     }
     
-    // Sort global results to get final TOPK
-    if (global_count > 0) {
-        sort_topk(global_indices, global_scores, global_count);
-        
-        int topk_count = (global_count < query_topk) ? global_count : query_topk;
+    // Order the final TOPK best-first
+    if (global_topk.count > 0) {
+        int topk_count = topk_sort(&global_topk);
         
         // Print TOPK results
         printf("==== TOP %d Recommendations (Pthreads) ====\n", topk_count);
         for (int i = 0; i < topk_count; i++) {
-            int idx = global_indices[i];
-            printf("%d. %s | %s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
+            int idx = global_topk.indices[i];
+            printf("%d. %.*s | %.*s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
                    i + 1,
-                   package_ids[idx],
-                   place_names[idx],
-                   provinces[idx],
-                   categories[idx],
-                   duration_days[idx],
-                   avg_prices[idx],
-                   ratings[idx],
-                   global_scores[i]);
+                   STORE_STR(&store, package_ids, idx),
+                   STORE_STR(&store, place_names, idx),
+                   STORE_PROVINCE(&store, idx),
+                   STORE_CATEGORY(&store, idx),
+                   store.duration_days[idx],
+                   store.avg_prices[idx],
+                   store.ratings[idx],
+                   global_topk.scores[i]);
         }
     } else {
         printf("No packages match the query filters.\n");
     }
     
+    // Per-thread load: how evenly the work was spread
+    double busy_max = 0.0;
+    double busy_sum = 0.0;
+    printf("\n==== Thread Load (%d chunks of %d rows) ====\n", num_chunks, job.chunk_rows);
+    for (int t = 0; t < num_threads; t++) {
+        PoolWorkerStats* st = &pool.stats[t];
+        printf("Thread %d: %lld chunks (%lld stolen), %d matches, busy %.3f ms\n",
+               t, st->chunks, st->stolen, local_matches[t], st->busy_seconds * 1000.0);
+        busy_sum += st->busy_seconds;
+        if (st->busy_seconds > busy_max) busy_max = st->busy_seconds;
+    }
+    if (busy_sum > 0.0) {
+        printf("Load balance: busiest thread %.3f ms, average %.3f ms (%.2fx)\n",
+               busy_max * 1000.0, busy_sum / num_threads * 1000.0, busy_max / (busy_sum / num_threads));
+    }
+    if (numa) {
+        printf("\n==== NUMA Layout (nodes: %d) ====\n", topo.num_nodes);
+        print_node_bandwidth(&topo, &pool, &job);
+    }
+    
     // End timing
     clock_t end = clock();
     double time_taken = ((double)(end - start)) / CLOCKS_PER_SEC;
     printf("\nExecution Time (Pthreads with %d threads): %.4f seconds\n", num_threads, time_taken);
     
-    pthread_mutex_destroy(&lock);
+    for (int t = 0; t < num_threads; t++) {
+        topk_free(&local_topk[t]);
+    }
+    free(local_topk);
+    free(local_matches);
+    free(local_rows);
+    topk_free(&global_topk);
+    pool_stop(&pool);
+    numa_unplace(&store, &placement);
+    free(cpus);
+    index_free(&store_index);
+    store_free(&store);
+    
     return 0;
 }
 
@@ -0,0 +1,131 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "query.h"
+
+void query_defaults(Query* q) {
+    q->province[0] = '\0';
+    q->category[0] = '\0';
+    q->province_code = DICT_ANY;
+    q->category_code = DICT_ANY;
+    q->budget_min = 0.0;
+    q->budget_max = QUERY_NO_BUDGET_MAX;
+    q->days = -1;
+    q->min_rating = 0.0;
+    q->topk = 5;
+    q->offset = 0;
+    q->format = QUERY_FORMAT_TEXT;
+}
+
+static int is_only_number(const char* s) {
+    if (s == NULL || s[0] == '\0') return 0;
+    for (int i = 0; s[i]; i++) {
+        if (s[i] < '0' || s[i] > '9') return 0;
+    }
+    return 1;
+}
+
+// Copy value[0..length) into a name field, truncating to fit
+static void copy_name(char* dst, const char* value, size_t length) {
+    if (length >= QUERY_MAX_NAME) length = QUERY_MAX_NAME - 1;
+    memcpy(dst, value, length);
+    dst[length] = '\0';
+}
+
+void query_parse(Query* q, const char* text, const PackageStore* s) {
+    query_defaults(q);
+
+    // If query is just a number => TOPK
+    if (is_only_number(text)) {
+        q->topk = atoi(text);
+    } else {
+        // Walk the ';'-separated tokens in place. atof/atoi stop at the ';'
+        // that ends a token, and names are copied with their length.
+        const char* token = text;
+        while (*token != '\0') {
+            const char* sep = strchr(token, ';');
+            size_t length = (sep != NULL) ? (size_t)(sep - token) : strlen(token);
+
+            if (strncmp(token, "PROVINCE=", 9) == 0) copy_name(q->province, token + 9, length - 9);
+            else if (strncmp(token, "CATEGORY=", 9) == 0) copy_name(q->category, token + 9, length - 9);
+            else if (strncmp(token, "BUDGET_MIN=", 11) == 0) q->budget_min = atof(token + 11);
+            else if (strncmp(token, "BUDGET_MAX=", 11) == 0) q->budget_max = atof(token + 11);
+            else if (strncmp(token, "DAYS=", 5) == 0) q->days = atoi(token + 5);
+            else if (strncmp(token, "MIN_RATING=", 11) == 0) q->min_rating = atof(token + 11);
+            else if (strncmp(token, "TOPK=", 5) == 0) q->topk = atoi(token + 5);
+            else if (strncmp(token, "OFFSET=", 7) == 0) q->offset = atoi(token + 7);
+            else if (strncmp(token, "FORMAT=BIN", 10) == 0) q->format = QUERY_FORMAT_BINARY;
+            else if (strncmp(token, "FORMAT=TEXT", 11) == 0) q->format = QUERY_FORMAT_TEXT;
+
+            if (sep == NULL) break;
+            token = sep + 1;
+        }
+    }
+
+    // Resolve names to dictionary codes once, so the filter compares integers
+    query_resolve(q, s);
+}
+
+void query_resolve(Query* q, const PackageStore* s) {
+    q->province_code = dict_query_code(&s->province_dict, q->province);
+    q->category_code = dict_query_code(&s->category_dict, q->category);
+}
+
+int query_canonical(const Query* q, char* key, int key_size) {
+    // %a prints doubles exactly, so only equal values share a key
+    int n = snprintf(key, key_size, "P%d;C%d;B%a-%a;D%d;R%a;K%d;O%d;F%d",
+                     q->province_code, q->category_code,
+                     q->budget_min, q->budget_max,
+                     q->days > 0 ? q->days : 0,
+                     q->min_rating, q->topk,
+                     q->offset > 0 ? q->offset : 0, q->format);
+    return (n < key_size) ? n : key_size - 1;
+}
+
+void query_batch_free(QueryBatch* b) {
+    for (int i = 0; i < b->count; i++) {
+        free(b->texts[i]);
+    }
+    free(b->queries);
+    free(b->texts);
+    memset(b, 0, sizeof(*b));
+}
+
+int query_batch_load(QueryBatch* b, const char* path, const PackageStore* s) {
+    memset(b, 0, sizeof(*b));
+    FILE* file = fopen(path, "r");
+    if (file == NULL) return -1;
+
+    int capacity = 0;
+    char line[QUERY_MAX_LINE];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (strchr(line, '\n') == NULL) {
+            // Over-long line: keep its first QUERY_MAX_LINE - 1 bytes
+            int c;
+            while ((c = fgetc(file)) != EOF && c != '\n') {}
+        }
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0') continue;
+
+        if (b->count == capacity) {
+            capacity = (capacity > 0) ? capacity * 2 : 64;
+            Query* queries = (Query*)realloc(b->queries, capacity * sizeof(Query));
+            if (queries != NULL) b->queries = queries;
+            char** texts = (char**)realloc(b->texts, capacity * sizeof(char*));
+            if (texts != NULL) b->texts = texts;
+            if (queries == NULL || texts == NULL) break;
+        }
+        b->texts[b->count] = strdup(line);
+        if (b->texts[b->count] == NULL) break;
+        query_parse(&b->queries[b->count], line, s);
+        b->count++;
+    }
+
+    int failed = ferror(file) || !feof(file);
+    fclose(file);
+    if (failed) {
+        query_batch_free(b);
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef QUERY_H
+#define QUERY_H
+
+#include "package_store.h"
+
+// A parsed recommendation query. The province/category names are kept for
+// display; the filter/score kernel (filter_kernel.h) reads the codes they
+// resolve to. A Query is a plain value: parse one per request and pass it
+// explicitly, so any number of queries can run at once over one shared,
+// read-only store.
+
+#define QUERY_NO_BUDGET_MAX 1000000.0   // budget_max default: no upper bound
+#define QUERY_MAX_NAME 128
+
+// Response formats (server_udp only)
+#define QUERY_FORMAT_TEXT 0
+#define QUERY_FORMAT_BINARY 1
+
+typedef struct {
+    char province[QUERY_MAX_NAME];   // "" means any
+    char category[QUERY_MAX_NAME];
+    int province_code;    // DICT_ANY, a code, or DICT_NONE (matches nothing)
+    int category_code;
+    double budget_min;
+    double budget_max;    // closeness is scored only below QUERY_NO_BUDGET_MAX
+    int days;             // <= 0: any duration
+    double min_rating;
+    int topk;
+    int offset;           // server_udp: first rank to return (paging), 0-based
+    int format;           // server_udp: QUERY_FORMAT_TEXT or QUERY_FORMAT_BINARY
+} Query;
+
+// No filters, TOPK=5, OFFSET=0, text format
+void query_defaults(Query* q);
+
+// Parse "KEY=value;KEY=value..." (PROVINCE, CATEGORY, BUDGET_MIN,
+// BUDGET_MAX, DAYS, MIN_RATING, TOPK, OFFSET, FORMAT=TEXT|BIN) or a bare
+// number (TOPK) into q, then resolve the names against s's dictionaries.
+// Unknown keys are ignored and text is not modified, so this is safe to
+// call from several threads.
+void query_parse(Query* q, const char* text, const PackageStore* s);
+
+// Resolve q's province/category names against s's dictionaries (the last
+// step of query_parse). Codes are per store, so a Query parsed against one
+// store must be resolved again before it runs on another.
+void query_resolve(Query* q, const PackageStore* s);
+
+// Write a canonical form of q into key (at most key_size bytes, NUL
+// included): every field in a fixed order, names as their resolved codes
+// and equivalent values (any DAYS <= 0, any OFFSET <= 0) folded together,
+// so two query strings that select and rank the same rows get the same
+// key. Returns the key length.
+int query_canonical(const Query* q, char* key, int key_size);
+
+// Queries read from a file, one query string per line
+typedef struct {
+    int count;
+    Query* queries;
+    char** texts;         // the line each query was parsed from
+} QueryBatch;
+
+#define QUERY_MAX_LINE 1024
+
+// Parse every non-blank line of path with query_parse (longer lines are
+// cut to QUERY_MAX_LINE - 1 bytes). Returns 0, or -1 if the file cannot be
+// read or memory runs out.
+int query_batch_load(QueryBatch* b, const char* path, const PackageStore* s);
+void query_batch_free(QueryBatch* b);
+
+#endif
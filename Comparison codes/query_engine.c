@@ -0,0 +1,137 @@
+#include <stdlib.h>
+#include <math.h>
+#include "query_engine.h"
+
+// Keep rows[0..n) if probing them is cheaper than the current candidates
+// (n < 0: no candidates). cost is the relative cost of probing one row.
+static void consider(QueryPlan* plan, long long* best_cost, const int* rows, int n, int cost) {
+    if (n < 0) return;
+    if (plan->candidates == NULL || (long long)n * cost < *best_cost) {
+        plan->candidates = rows;
+        plan->length = n;
+        *best_cost = (long long)n * cost;
+    }
+}
+
+static void consider_list(QueryPlan* plan, long long* best_cost, const PostingIndex* p, int value) {
+    const int* rows = NULL;
+    int n = posting_range(p, value, plan->begin, plan->end, &rows);
+    consider(plan, best_cost, rows, n, 1);
+}
+
+// Windows visit rows in value order, so each probe is a cache miss rather
+// than a forward walk. They also cannot be narrowed to a row range: a plan
+// over part of the store (one worker's chunk) would walk the whole window
+// and skip most of it, so only plans over every indexed row consider one.
+static void consider_window(QueryPlan* plan, long long* best_cost, const RangeIndex* r,
+                            double min, double max) {
+    if (plan->begin > 0 || plan->end < r->count) return;
+    const int* rows = NULL;
+    int n = range_window(r, min, max, &rows);
+    consider(plan, best_cost, rows, n, ENGINE_WINDOW_COST);
+}
+
+void engine_plan(const PackageIndex* idx, const Query* q, int begin, int end, QueryPlan* plan) {
+    plan->candidates = NULL;
+    plan->begin = begin;
+    plan->end = end;
+    plan->length = (end > begin) ? end - begin : 0;
+
+    // A value missing from the dataset matches nothing
+    if (q->province_code == DICT_NONE || q->category_code == DICT_NONE) {
+        plan->length = 0;
+        return;
+    }
+    if (idx == NULL || plan->length == 0) return;
+
+    int scan_rows = plan->length;
+    long long best_cost = 0;
+    if (q->province_code != DICT_ANY) consider_list(plan, &best_cost, &idx->province, q->province_code);
+    if (q->category_code != DICT_ANY) consider_list(plan, &best_cost, &idx->category, q->category_code);
+    if (q->days > 0) consider_list(plan, &best_cost, &idx->duration, q->days);
+    consider_window(plan, &best_cost, &idx->price, q->budget_min, q->budget_max);
+    consider_window(plan, &best_cost, &idx->rating, q->min_rating, INFINITY);
+
+    // Not selective enough: the scan is cheaper
+    if (plan->candidates != NULL && best_cost * ENGINE_SCAN_RATIO > scan_rows) {
+        plan->candidates = NULL;
+        plan->length = scan_rows;
+    }
+}
+
+int engine_eval(const PackageStore* s, const Query* q, const QueryPlan* plan,
+                int from, int to, int* rows, double* scores) {
+    if (plan->candidates == NULL) {
+        return filter_score_range(s, q, plan->begin + from, plan->begin + to, rows, scores);
+    }
+
+    int n = 0;
+    for (int i = from; i < to; i++) {
+        int row = plan->candidates[i];
+        if (row < plan->begin || row >= plan->end) continue;
+        if (filter_row_matches(s, q, row)) {
+            rows[n] = row;
+            scores[n] = filter_row_score(s, q, row);
+            n++;
+        }
+    }
+    return n;
+}
+
+// Evaluate a whole plan tile by tile, pushing matches into t
+static int plan_topk(const PackageStore* s, const Query* q, const QueryPlan* plan, TopK* t) {
+    int rows[FILTER_TILE_ROWS];
+    double scores[FILTER_TILE_ROWS];
+    int matched = 0;
+
+    for (int tile = 0; tile < plan->length; tile += FILTER_TILE_ROWS) {
+        int tile_end = (plan->length - tile > FILTER_TILE_ROWS) ? tile + FILTER_TILE_ROWS : plan->length;
+        int n = engine_eval(s, q, plan, tile, tile_end, rows, scores);
+        for (int j = 0; j < n; j++) {
+            topk_push(t, rows[j], scores[j]);
+        }
+        matched += n;
+    }
+    return matched;
+}
+
+int engine_topk(const PackageStore* s, const PackageIndex* idx, const Query* q,
+                int begin, int end, TopK* t) {
+    QueryPlan plan;
+    engine_plan(idx, q, begin, end, &plan);
+    return plan_topk(s, q, &plan, t);
+}
+
+void engine_topk_batch(const PackageStore* s, const PackageIndex* idx, const Query* qs,
+                       int num_queries, int begin, int end, TopK* tops, int* matched) {
+    int rows[FILTER_TILE_ROWS];
+    double scores[FILTER_TILE_ROWS];
+
+    for (int block = 0; block < num_queries; block += ENGINE_BATCH_QUERIES) {
+        int block_end = (num_queries - block > ENGINE_BATCH_QUERIES) ? block + ENGINE_BATCH_QUERIES : num_queries;
+
+        // Selective queries walk their own candidates; the rest share one scan
+        int scan[ENGINE_BATCH_QUERIES];
+        int num_scan = 0;
+        for (int i = block; i < block_end; i++) {
+            QueryPlan plan;
+            engine_plan(idx, &qs[i], begin, end, &plan);
+            if (plan.candidates != NULL) matched[i] += plan_topk(s, &qs[i], &plan, &tops[i]);
+            else if (plan.length > 0) scan[num_scan++] = i;
+        }
+        if (num_scan == 0) continue;
+
+        // Every scanning query reads a tile while it is still in cache
+        for (int tile = begin; tile < end; tile += FILTER_TILE_ROWS) {
+            int tile_end = (end - tile > FILTER_TILE_ROWS) ? tile + FILTER_TILE_ROWS : end;
+            for (int j = 0; j < num_scan; j++) {
+                int i = scan[j];
+                int n = filter_score_range(s, &qs[i], tile, tile_end, rows, scores);
+                for (int k = 0; k < n; k++) {
+                    topk_push(&tops[i], rows[k], scores[k]);
+                }
+                matched[i] += n;
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef QUERY_ENGINE_H
+#define QUERY_ENGINE_H
+
+#include "package_store.h"
+#include "package_index.h"
+#include "filter_kernel.h"
+#include "topk.h"
+
+// Chooses how to evaluate a query over a row range: a SIMD scan of every
+// row (filter_kernel.h), or a walk over the smallest candidate set the
+// indexes offer (package_index.h), probing the remaining predicates on each
+// candidate row. Candidate sets are the posting lists of the query's
+// equality predicates (PROVINCE, CATEGORY, DAYS) and the sorted-column
+// windows of its range predicates (BUDGET_MIN..BUDGET_MAX, MIN_RATING).
+// Candidates are used only when there are fewer than 1 in
+// ENGINE_SCAN_RATIO of the rows, since probing a candidate costs several
+// times more than scanning a row. Window candidates count ENGINE_WINDOW_COST
+// times, as they are visited in value order instead of row order, and are
+// only considered when the plan covers the whole store (a window cannot be
+// narrowed to a row range); callers splitting a query should plan once over
+// every row and split the plan's positions, as engine_eval allows.
+//
+// engine_topk_batch evaluates many queries in one pass: the queries that
+// would scan share it, each tile of FILTER_TILE_ROWS rows being filtered
+// for up to ENGINE_BATCH_QUERIES queries while it is cache-resident, so a
+// batch costs about one read of the columns per block of queries.
+
+#define ENGINE_SCAN_RATIO 8
+#define ENGINE_WINDOW_COST 2
+#define ENGINE_BATCH_QUERIES 64
+
+typedef struct {
+    const int* candidates;  // row ids to probe, or NULL for a scan
+    int begin;              // row range; candidates outside it are skipped
+    int end;
+    int length;             // rows to scan / candidates to probe
+} QueryPlan;
+
+// Plan q over rows [begin, end). idx may be NULL (always scan).
+void engine_plan(const PackageIndex* idx, const Query* q, int begin, int end, QueryPlan* plan);
+
+// Evaluate plan positions [from, to) (rows for a scan, candidates for a
+// list) into rows[]/scores[]. Scans and posting lists emit rows in row
+// order, sorted-column windows in value order. Returns the number of
+// matches.
+int engine_eval(const PackageStore* s, const Query* q, const QueryPlan* plan,
+                int from, int to, int* rows, double* scores);
+
+// Plan and evaluate rows [begin, end), pushing matches into t. Returns the
+// number of matches.
+int engine_topk(const PackageStore* s, const PackageIndex* idx, const Query* q,
+                int begin, int end, TopK* t);
+
+// engine_topk for qs[0..num_queries) over rows [begin, end): matches of
+// qs[i] are pushed into tops[i] and counted into matched[i] (added to, so
+// the caller zeroes it). tops[i] is initialised by the caller.
+void engine_topk_batch(const PackageStore* s, const PackageIndex* idx, const Query* qs,
+                       int num_queries, int begin, int end, TopK* tops, int* matched);
+
+#endif
@@ -0,0 +1,164 @@
+#include <stdlib.h>
+#include <string.h>
+#include "response_cache.h"
+
+int cache_init(ResponseCache* c, int capacity, int max_response) {
+    memset(c, 0, sizeof(*c));
+    pthread_mutex_init(&c->lock, NULL);
+    if (capacity <= 0 || max_response <= 0) return 0;
+
+    // About two buckets per entry keeps chains short
+    unsigned int buckets = 1;
+    while (buckets < 2u * (unsigned int)capacity) buckets <<= 1;
+
+    c->entries = (CacheEntry*)calloc(capacity, sizeof(CacheEntry));
+    c->buckets = (CacheEntry**)calloc(buckets, sizeof(CacheEntry*));
+    c->responses = (char*)malloc((size_t)capacity * max_response);
+    if (c->entries == NULL || c->buckets == NULL || c->responses == NULL) {
+        cache_free(c);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) {
+        c->entries[i].response = c->responses + (size_t)i * max_response;
+    }
+    c->capacity = capacity;
+    c->max_response = max_response;
+    c->num_buckets = buckets;
+    return 0;
+}
+
+void cache_free(ResponseCache* c) {
+    free(c->responses);
+    free(c->entries);
+    free(c->buckets);
+    pthread_mutex_destroy(&c->lock);
+    memset(c, 0, sizeof(*c));
+}
+
+// FNV-1a
+static unsigned int hash_key(const char* key) {
+    unsigned int h = 2166136261u;
+    for (; *key; key++) {
+        h ^= (unsigned char)*key;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static CacheEntry** bucket_of(ResponseCache* c, const char* key) {
+    return &c->buckets[hash_key(key) & (c->num_buckets - 1)];
+}
+
+static CacheEntry* find(ResponseCache* c, const char* key) {
+    for (CacheEntry* e = *bucket_of(c, key); e != NULL; e = e->hash_next) {
+        if (strcmp(e->key, key) == 0) return e;
+    }
+    return NULL;
+}
+
+static void lru_unlink(ResponseCache* c, CacheEntry* e) {
+    if (e->lru_prev != NULL) e->lru_prev->lru_next = e->lru_next;
+    else c->lru_head = e->lru_next;
+    if (e->lru_next != NULL) e->lru_next->lru_prev = e->lru_prev;
+    else c->lru_tail = e->lru_prev;
+    e->lru_prev = NULL;
+    e->lru_next = NULL;
+}
+
+static void lru_push_front(ResponseCache* c, CacheEntry* e) {
+    e->lru_prev = NULL;
+    e->lru_next = c->lru_head;
+    if (c->lru_head != NULL) c->lru_head->lru_prev = e;
+    c->lru_head = e;
+    if (c->lru_tail == NULL) c->lru_tail = e;
+}
+
+static void hash_unlink(ResponseCache* c, CacheEntry* e) {
+    CacheEntry** link = bucket_of(c, e->key);
+    while (*link != e) link = &(*link)->hash_next;
+    *link = e->hash_next;
+    e->hash_next = NULL;
+}
+
+int cache_get(ResponseCache* c, const char* key, char* out, int out_size, unsigned long* generation) {
+    pthread_mutex_lock(&c->lock);
+    *generation = c->generation;
+
+    CacheEntry* e = (c->capacity > 0) ? find(c, key) : NULL;
+    if (e == NULL) {
+        c->stats.misses++;
+        pthread_mutex_unlock(&c->lock);
+        return -1;
+    }
+
+    c->stats.hits++;
+    lru_unlink(c, e);
+    lru_push_front(c, e);
+
+    int length = (e->length < out_size) ? e->length : out_size - 1;
+    memcpy(out, e->response, length);
+    out[length] = '\0';
+    pthread_mutex_unlock(&c->lock);
+    return length;
+}
+
+void cache_put(ResponseCache* c, const char* key, unsigned long generation,
+               const char* response, int length) {
+    if (c->capacity == 0 || strlen(key) >= CACHE_MAX_KEY || length >= c->max_response) return;
+
+    pthread_mutex_lock(&c->lock);
+    if (generation != c->generation) {
+        pthread_mutex_unlock(&c->lock);
+        return;
+    }
+
+    // Another worker may have answered the same query meanwhile
+    CacheEntry* e = find(c, key);
+    if (e != NULL) {
+        lru_unlink(c, e);
+    } else if (c->count < c->capacity) {
+        e = &c->entries[c->count++];
+    } else {
+        e = c->lru_tail;
+        lru_unlink(c, e);
+        hash_unlink(c, e);
+        c->stats.evictions++;
+    }
+
+    if (strcmp(e->key, key) != 0) {
+        strcpy(e->key, key);
+        CacheEntry** bucket = bucket_of(c, key);
+        e->hash_next = *bucket;
+        *bucket = e;
+    }
+    memcpy(e->response, response, length);
+    e->response[length] = '\0';
+    e->length = length;
+    lru_push_front(c, e);
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cache_invalidate(ResponseCache* c) {
+    pthread_mutex_lock(&c->lock);
+    for (int i = 0; i < c->count; i++) {
+        c->entries[i].key[0] = '\0';
+        c->entries[i].length = 0;
+        c->entries[i].hash_next = NULL;
+        c->entries[i].lru_prev = NULL;
+        c->entries[i].lru_next = NULL;
+    }
+    if (c->num_buckets > 0) memset(c->buckets, 0, c->num_buckets * sizeof(CacheEntry*));
+    c->lru_head = NULL;
+    c->lru_tail = NULL;
+    c->count = 0;
+    c->generation++;
+    c->stats.invalidations++;
+    pthread_mutex_unlock(&c->lock);
+}
+
+void cache_stats(ResponseCache* c, CacheStats* out) {
+    pthread_mutex_lock(&c->lock);
+    *out = c->stats;
+    out->entries = c->count;
+    pthread_mutex_unlock(&c->lock);
+}
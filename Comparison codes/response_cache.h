@@ -0,0 +1,70 @@
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <pthread.h>
+
+// Bounded LRU cache of formatted responses, keyed by a string (the server
+// uses query_canonical). Lookups and inserts take one mutex, so any number
+// of workers can share a cache.
+//
+// Every entry belongs to a generation. cache_invalidate() empties the cache
+// and starts a new generation; an answer computed before that (its
+// cache_get reported the old generation) is not inserted by cache_put, so
+// results from a replaced dataset never come back.
+
+#define CACHE_MAX_KEY 160
+
+typedef struct CacheEntry {
+    char key[CACHE_MAX_KEY];
+    char* response;                 // max_response bytes in the shared block
+    int length;
+    struct CacheEntry* hash_next;
+    struct CacheEntry* lru_prev;    // towards the most recently used
+    struct CacheEntry* lru_next;
+} CacheEntry;
+
+typedef struct {
+    long long hits;
+    long long misses;
+    long long evictions;
+    long long invalidations;
+    int entries;
+} CacheStats;
+
+typedef struct {
+    int capacity;                   // 0: cache disabled (every lookup misses)
+    int max_response;               // longest response kept, NUL included
+    int count;
+    CacheEntry* entries;            // capacity slots, the first count in use
+    char* responses;                // capacity * max_response bytes
+    CacheEntry** buckets;
+    unsigned int num_buckets;       // power of two
+    CacheEntry* lru_head;           // most recently used
+    CacheEntry* lru_tail;           // next to evict
+    unsigned long generation;
+    CacheStats stats;
+    pthread_mutex_t lock;
+} ResponseCache;
+
+// Room for capacity responses of up to max_response bytes (NUL included),
+// allocated up front. Returns 0, or -1 if out of memory.
+int cache_init(ResponseCache* c, int capacity, int max_response);
+void cache_free(ResponseCache* c);
+
+// Copy the response cached under key into out (NUL-terminated, cut to
+// out_size - 1 bytes) and return its length, or -1 on a miss. *generation
+// is set either way; pass it to cache_put with the computed answer.
+int cache_get(ResponseCache* c, const char* key, char* out, int out_size, unsigned long* generation);
+
+// Insert (or refresh) key -> response[0..length), evicting the least
+// recently used entry when full. Ignored if the cache was invalidated since
+// the generation was read, or if key or response do not fit.
+void cache_put(ResponseCache* c, const char* key, unsigned long generation,
+               const char* response, int length);
+
+// Drop every entry (the dataset changed)
+void cache_invalidate(ResponseCache* c);
+
+void cache_stats(ResponseCache* c, CacheStats* out);
+
+#endif
@@ -1,250 +1,581 @@
+// server_udp.c
+// Build: gcc server_udp.c filter_kernel.c package_index.c package_store.c query.c query_engine.c response_cache.c snapshot.c string_dict.c topk.c -o server_udp -lm -pthread
+
+#define _GNU_SOURCE   // recvmmsg / sendmmsg
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <signal.h>
 #include <time.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <sys/types.h>
+#include <pthread.h>
+#include "package_store.h"
+#include "snapshot.h"
+#include "query.h"
+#include "topk.h"
+#include "package_index.h"
+#include "query_engine.h"
+#include "response_cache.h"
 
-#define MAX_LINE_LENGTH 2048
-#define MAX_PACKAGES 1000
-#define MAX_FIELDS 20
 #define BUFFER_SIZE 4096
+#define QUEUE_CAPACITY 256
+#define RECV_BATCH 64          // datagrams read per recvmmsg call
+#define SEND_BATCH 16          // requests a worker takes (and answers with one sendmmsg)
+#define LOG_BUFFER_SIZE (1 << 20)
+#define CACHE_ENTRIES 1024     // default response cache size
+#define RELOAD_POLL_MS 1000    // how often the dataset's mtime is checked
 
-// Global arrays to store package data (no structs)
-char package_ids[MAX_PACKAGES][32];
-char place_names[MAX_PACKAGES][256];
-char provinces[MAX_PACKAGES][128];
-char categories[MAX_PACKAGES][128];
-int duration_days[MAX_PACKAGES];
-double avg_prices[MAX_PACKAGES];
-double ratings[MAX_PACKAGES];
-int reviews_counts[MAX_PACKAGES];
-double popularity_scores[MAX_PACKAGES];
-
-int total_packages = 0;
-
-// Query parameters
-char query_province[128] = "";
-char query_category[128] = "";
-double query_budget_min = 0.0;
-double query_budget_max = 1000000.0;
-int query_days = -1;
-double query_min_rating = 0.0;
-int query_topk = 5;
-
-// Function to parse a line and extract fields (TAB-delimited)
-int parse_line(char* line, int package_index) {
-    char* token;
-    int field_index = 0;
-    
-    if (strstr(line, "package_id") != NULL) {
-        return 0;
+// One loaded version of the package catalogue. It is never modified once
+// published, so every worker can query it without locking. A reload builds
+// a new one in the background and swaps current_catalogue (see reload_main).
+typedef struct {
+    PackageStore store;
+    PackageIndex index;         // posting lists and sorted columns over store
+    unsigned long version;      // 1 for the catalogue loaded at start-up
+} Catalogue;
+
+Catalogue* current_catalogue;
+const char* dataset_file;
+volatile sig_atomic_t reload_requested = 0;   // set by SIGHUP
+
+// Epoch-based reclamation of replaced catalogues. A worker publishes the
+// current epoch in its slot before it reads current_catalogue, and clears
+// the slot (0) once its batch is answered. After a swap the reloader
+// advances the epoch and waits until no slot holds an older one: then no
+// worker can still be using the old catalogue, and it is freed. Queries in
+// flight finish on the version they started with.
+unsigned long global_epoch = 1;
+unsigned long* worker_epochs;   // one slot per worker
+int num_workers;
+
+// One datagram waiting for a worker
+typedef struct {
+    char query[BUFFER_SIZE];
+    struct sockaddr_in client;
+    socklen_t client_len;
+} Request;
+
+// Bounded FIFO from the receiver thread to the workers. When it is full the
+// receiver stops reading and further datagrams wait in the socket buffer.
+Request request_queue[QUEUE_CAPACITY];
+int queue_head = 0;
+int queue_count = 0;
+pthread_mutex_t queue_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t queue_not_empty = PTHREAD_COND_INITIALIZER;
+pthread_cond_t queue_not_full = PTHREAD_COND_INITIALIZER;
+
+int sockfd;
+
+// Formatted responses of recent queries, keyed by query_canonical()
+ResponseCache response_cache;
+
+// Syscall and traffic counters, reported by a "STATS" request
+long long stat_epoll_waits = 0;
+long long stat_recv_calls = 0;
+long long stat_send_calls = 0;
+long long stat_queries = 0;
+long long stat_log_dropped = 0;
+long long stat_reloads = 0;
+
+#define STAT_ADD(counter, n) __atomic_fetch_add(&(counter), (n), __ATOMIC_RELAXED)
+#define STAT_GET(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+// ---------------- Asynchronous request log ----------------
+// Request threads append formatted lines to a buffer under a short lock; a
+// logger thread swaps buffers and writes the full one to stdout, so no
+// request waits on stdout. Lines that do not fit are dropped and counted.
+int log_enabled = 1;
+char log_buffers[2][LOG_BUFFER_SIZE];
+char* log_fill = log_buffers[0];
+size_t log_used = 0;
+pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t log_ready = PTHREAD_COND_INITIALIZER;
+
+void log_request(const char* format, ...) {
+    if (!log_enabled) return;
+
+    char line[BUFFER_SIZE + 128];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    if (n < 0) return;
+    if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+
+    pthread_mutex_lock(&log_lock);
+    if (log_used + n <= LOG_BUFFER_SIZE) {
+        memcpy(log_fill + log_used, line, n);
+        log_used += n;
+        pthread_cond_signal(&log_ready);
+    } else {
+        stat_log_dropped++;
     }
-    
-    token = strtok(line, "\t");
-    while (token != NULL && field_index < MAX_FIELDS) {
-        char* newline = strchr(token, '\n');
-        if (newline) *newline = '\0';
-        
-        if (field_index == 0) strncpy(package_ids[package_index], token, 31);
-        else if (field_index == 1) strncpy(place_names[package_index], token, 255);
-        else if (field_index == 2) strncpy(provinces[package_index], token, 127);
-        else if (field_index == 5) strncpy(categories[package_index], token, 127);
-        else if (field_index == 6) duration_days[package_index] = atoi(token);
-        else if (field_index == 8) avg_prices[package_index] = atof(token);
-        else if (field_index == 12) ratings[package_index] = atof(token);
-        else if (field_index == 13) reviews_counts[package_index] = atoi(token);
-        else if (field_index == 14) popularity_scores[package_index] = atof(token);
-        
-        token = strtok(NULL, "\t");
-        field_index++;
+    pthread_mutex_unlock(&log_lock);
+}
+
+void* logger_main(void* arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&log_lock);
+        while (log_used == 0) {
+            pthread_cond_wait(&log_ready, &log_lock);
+        }
+        char* full = log_fill;
+        size_t bytes = log_used;
+        log_fill = (full == log_buffers[0]) ? log_buffers[1] : log_buffers[0];
+        log_used = 0;
+        pthread_mutex_unlock(&log_lock);
+
+        fwrite(full, 1, bytes, stdout);
+        fflush(stdout);
     }
-    
-    return 1;
+    return NULL;
 }
 
-// Function to parse query string
-void parse_query(char* query_str) {
-    strcpy(query_province, "");
-    strcpy(query_category, "");
-    query_budget_min = 0.0;
-    query_budget_max = 1000000.0;
-    query_days = -1;
-    query_min_rating = 0.0;
-    query_topk = 5;
+// ---------------- Response formats ----------------
+// Text (default): a "FOUND n matching packages. TOP k:" line, then one line
+// per result numbered by rank. Results are written whole; when the next one
+// does not fit in the datagram the response ends with
+// "MORE OFFSET=<rank> TOPK=<left>\n", the query that continues the page.
+//
+// Binary (FORMAT=BIN), little-endian:
+//   header  "WHB1", u32 catalogue version, u32 matches, u32 offset (rank of
+//           the first record, 0-based), u32 records, u32 results still to
+//           fetch (continue with OFFSET=offset+records, TOPK=that many)
+//   record  u32 row, u8 province code, u8 category code, i32 days,
+//           f64 price, f64 rating, f64 score, u8 length + package id,
+//           u8 length + place name
+// Province and category are dictionary codes; a "DICT" request returns
+// their names for the same catalogue version.
+#define BIN_MAGIC "WHB1"
+#define BIN_HEADER_SIZE 24
+#define MORE_LINE_RESERVE 48   // room kept for the text "MORE ..." line
+
+static char* put_u32(char* p, unsigned int v) {
+    p[0] = (char)(v & 0xFF);
+    p[1] = (char)((v >> 8) & 0xFF);
+    p[2] = (char)((v >> 16) & 0xFF);
+    p[3] = (char)((v >> 24) & 0xFF);
+    return p + 4;
+}
+
+static char* put_f64(char* p, double v) {
+    unsigned long long bits;
+    memcpy(&bits, &v, sizeof(bits));
+    p = put_u32(p, (unsigned int)(bits & 0xFFFFFFFFu));
+    return put_u32(p, (unsigned int)(bits >> 32));
+}
+
+static char* put_str(char* p, const char* s, int length) {
+    if (length > 255) length = 255;
+    *p++ = (char)length;
+    memcpy(p, s, length);
+    return p + length;
+}
+
+// Results ranked [first, last) of a sorted TopK. Returns the response length.
+int format_text(const PackageStore* store, const TopK* topk, int filtered_count, int first, int last,
+                char* response, int response_size) {
+    int pos = snprintf(response, response_size, "FOUND %d matching packages. TOP %d:\n",
+                       filtered_count, last - first);
     
-    char* token = strtok(query_str, ";");
-    while (token != NULL) {
-        if (strncmp(token, "PROVINCE=", 9) == 0) {
-            strcpy(query_province, token + 9);
-        } else if (strncmp(token, "CATEGORY=", 9) == 0) {
-            strcpy(query_category, token + 9);
-        } else if (strncmp(token, "BUDGET_MIN=", 11) == 0) {
-            query_budget_min = atof(token + 11);
-        } else if (strncmp(token, "BUDGET_MAX=", 11) == 0) {
-            query_budget_max = atof(token + 11);
-        } else if (strncmp(token, "DAYS=", 5) == 0) {
-            query_days = atoi(token + 5);
-        } else if (strncmp(token, "MIN_RATING=", 11) == 0) {
-            query_min_rating = atof(token + 11);
-        } else if (strncmp(token, "TOPK=", 5) == 0) {
-            query_topk = atoi(token + 5);
+    for (int i = first; i < last; i++) {
+        int idx = topk->indices[i];
+        char line[512];
+        int n = snprintf(line, sizeof(line),
+                "%d. %.*s | %.*s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
+                i + 1,
+                STORE_STR(store, package_ids, idx),
+                STORE_STR(store, place_names, idx),
+                STORE_PROVINCE(store, idx),
+                STORE_CATEGORY(store, idx),
+                store->duration_days[idx],
+                store->avg_prices[idx],
+                store->ratings[idx],
+                topk->scores[i]);
+        if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+        
+        // The last line needs no room for a MORE line after it
+        int reserve = (i + 1 < last) ? MORE_LINE_RESERVE : 0;
+        if (pos + n + reserve >= response_size) {
+            pos += snprintf(response + pos, response_size - pos, "MORE OFFSET=%d TOPK=%d\n", i, last - i);
+            return pos;
         }
-        token = strtok(NULL, ";");
+        memcpy(response + pos, line, n + 1);
+        pos += n;
     }
+    return pos;
 }
 
-// Function to check if a package matches the query filters
-int matches_filter(int index) {
-    if (strlen(query_province) > 0 && strcmp(provinces[index], query_province) != 0) {
-        return 0;
-    }
-    if (strlen(query_category) > 0 && strcmp(categories[index], query_category) != 0) {
-        return 0;
-    }
-    if (avg_prices[index] < query_budget_min || avg_prices[index] > query_budget_max) {
-        return 0;
-    }
-    if (query_days > 0 && duration_days[index] != query_days) {
-        return 0;
-    }
-    if (ratings[index] < query_min_rating) {
-        return 0;
+int format_binary(const Catalogue* cat, const TopK* topk, int filtered_count, int first, int last,
+                  char* response, int response_size) {
+    const PackageStore* store = &cat->store;
+    char* p = response + BIN_HEADER_SIZE;
+    char* end = response + response_size;
+    
+    int i = first;
+    for (; i < last; i++) {
+        int idx = topk->indices[i];
+        int id_len = store->package_ids[idx].length;
+        int name_len = store->place_names[idx].length;
+        if (id_len > 255) id_len = 255;
+        if (name_len > 255) name_len = 255;
+        if (p + 34 + 2 + id_len + name_len > end) break;
+        
+        p = put_u32(p, (unsigned int)idx);
+        *p++ = (char)store->province_codes[idx];
+        *p++ = (char)store->category_codes[idx];
+        p = put_u32(p, (unsigned int)store->duration_days[idx]);
+        p = put_f64(p, store->avg_prices[idx]);
+        p = put_f64(p, store->ratings[idx]);
+        p = put_f64(p, topk->scores[i]);
+        p = put_str(p, store->text + store->package_ids[idx].offset, id_len);
+        p = put_str(p, store->text + store->place_names[idx].offset, name_len);
     }
-    return 1;
+    
+    char* h = response;
+    memcpy(h, BIN_MAGIC, 4);
+    h = put_u32(h + 4, (unsigned int)cat->version);
+    h = put_u32(h, (unsigned int)filtered_count);
+    h = put_u32(h, (unsigned int)first);
+    h = put_u32(h, (unsigned int)(i - first));
+    put_u32(h, (unsigned int)(last - i));
+    return (int)(p - response);
 }
 
-// Function to calculate score for a package
-double calculate_score(int index) {
-    double score = 0.0;
-    score += 50.0 * ratings[index];
-    score += 10.0 * popularity_scores[index];
-    score += 5.0 * log(reviews_counts[index] + 1.0);
+// Function to process query and return results. Everything a request needs
+// lives on this call's stack, so workers run it concurrently. Returns the
+// response length (binary responses contain NULs), or -1 if the response
+// is an error that should not be cached.
+int process_query_and_format(const Catalogue* cat, const Query* q, char* response, int response_size) {
+    const PackageStore* store = &cat->store;
     
-    if (query_budget_max < 1000000.0) {
-        double budget_diff = fabs(avg_prices[index] - query_budget_max);
-        double budget_closeness = 100.0 / (1.0 + budget_diff / 1000.0);
-        score += budget_closeness;
+    // Filter and score packages, keeping the best offset + topk (never more
+    // than there are rows)
+    int first = (q->offset > 0) ? q->offset : 0;
+    long long keep = (long long)first + (q->topk > 0 ? q->topk : 0);
+    if (keep > store->count) keep = store->count;
+    TopK topk;
+    if (topk_init(&topk, (int)keep) != 0) {
+        snprintf(response, response_size, "Server error: out of memory.\n");
+        return -1;
     }
+    int filtered_count = engine_topk(store, &cat->index, q, 0, store->count, &topk);
     
-    if (query_days > 0) {
-        int duration_diff = abs(duration_days[index] - query_days);
-        double duration_closeness = 50.0 / (1.0 + duration_diff);
-        score += duration_closeness;
+    // Order TOPK best-first, then cut this page out of it
+    int kept = topk_sort(&topk);
+    int last = (kept < keep) ? kept : (int)keep;
+    if (first > last) first = last;
+    
+    int length;
+    if (q->format == QUERY_FORMAT_BINARY) {
+        length = format_binary(cat, &topk, filtered_count, first, last, response, response_size);
+    } else if (filtered_count > 0) {
+        length = format_text(store, &topk, filtered_count, first, last, response, response_size);
+    } else {
+        length = snprintf(response, response_size, "No packages match the query filters.\n");
     }
     
-    return score;
+    topk_free(&topk);
+    return length;
 }
 
-// Simple bubble sort for TOPK
-void sort_topk(int* indices, double* scores, int count) {
-    for (int i = 0; i < count - 1; i++) {
-        for (int j = 0; j < count - i - 1; j++) {
-            if (scores[j] < scores[j + 1]) {
-                double temp_score = scores[j];
-                scores[j] = scores[j + 1];
-                scores[j + 1] = temp_score;
-                int temp_idx = indices[j];
-                indices[j] = indices[j + 1];
-                indices[j + 1] = temp_idx;
+// "DICT": the province and category dictionaries of the current catalogue,
+// one "PROVINCE <code> <name>" / "CATEGORY <code> <name>" line each, paged
+// like text results ("DICT;OFFSET=n" continues at entry n)
+int format_dict(const Catalogue* cat, const char* request, char* response, int response_size) {
+    const StringDict* dicts[2] = { &cat->store.province_dict, &cat->store.category_dict };
+    const char* labels[2] = { "PROVINCE", "CATEGORY" };
+    const char* offset_arg = strstr(request, "OFFSET=");
+    int first = (offset_arg != NULL) ? atoi(offset_arg + 7) : 0;
+    
+    int pos = snprintf(response, response_size, "DICT version=%lu\n", cat->version);
+    int entry = 0;
+    for (int d = 0; d < 2; d++) {
+        for (int code = 0; code < dicts[d]->count; code++, entry++) {
+            if (entry < first) continue;
+            char line[512];
+            int n = snprintf(line, sizeof(line), "%s %d %s\n", labels[d], code, dict_value(dicts[d], code));
+            if (n >= (int)sizeof(line)) n = sizeof(line) - 1;
+            if (pos + n + MORE_LINE_RESERVE >= response_size) {
+                return pos + snprintf(response + pos, response_size - pos, "MORE OFFSET=%d\n", entry);
             }
+            memcpy(response + pos, line, n + 1);
+            pos += n;
         }
     }
+    return pos;
+}
+
+// Answer one request: "STATS" reports the counters, "DICT" the
+// dictionaries, anything else is a query, served from the response cache
+// when the same query (in canonical form, on the same catalogue version) was
+// answered recently. Returns the response length.
+int answer_request(const Catalogue* cat, const char* query_str, char* response, int response_size) {
+    if (strcmp(query_str, "STATS") == 0) {
+        pthread_mutex_lock(&log_lock);
+        long long log_dropped = stat_log_dropped;
+        pthread_mutex_unlock(&log_lock);
+        CacheStats cs;
+        cache_stats(&response_cache, &cs);
+        int n = snprintf(response, response_size,
+                 "STATS queries=%lld epoll_waits=%lld recv_calls=%lld send_calls=%lld log_dropped=%lld"
+                 " cache_hits=%lld cache_misses=%lld cache_evictions=%lld cache_invalidations=%lld cache_entries=%d"
+                 " reloads=%lld version=%lu packages=%d\n",
+                 STAT_GET(stat_queries), STAT_GET(stat_epoll_waits), STAT_GET(stat_recv_calls),
+                 STAT_GET(stat_send_calls), log_dropped,
+                 cs.hits, cs.misses, cs.evictions, cs.invalidations, cs.entries,
+                 STAT_GET(stat_reloads), cat->version, cat->store.count);
+        return (n < response_size) ? n : response_size - 1;
+    }
+    if (strncmp(query_str, "DICT", 4) == 0 && (query_str[4] == '\0' || query_str[4] == ';')) {
+        return format_dict(cat, query_str, response, response_size);
+    }
+    STAT_ADD(stat_queries, 1);
+
+    Query q;
+    query_parse(&q, query_str, &cat->store);
+    char key[CACHE_MAX_KEY];
+    int key_length = query_canonical(&q, key, sizeof(key));
+    snprintf(key + key_length, sizeof(key) - key_length, ";V%lu", cat->version);
+
+    unsigned long generation;
+    int length = cache_get(&response_cache, key, response, response_size, &generation);
+    if (length >= 0) return length;
+    length = process_query_and_format(cat, &q, response, response_size);
+    if (length < 0) return (int)strlen(response);
+    cache_put(&response_cache, key, generation, response, length);
+    return length;
 }
 
-// Function to process query and return results as string
-void process_query_and_format(char* query_str, char* response, int response_size) {
-    parse_query(query_str);
+// Worker thread: take a few requests off the queue at a time, answer them,
+// and send all the replies with one sendmmsg
+void* worker_main(void* arg) {
+    int worker_id = *(int*)arg;
+    Request reqs[SEND_BATCH];   // copied out so the slots are free while the queries run
+    char responses[SEND_BATCH][BUFFER_SIZE];
+    struct mmsghdr msgs[SEND_BATCH];
+    struct iovec iovs[SEND_BATCH];
     
-    // Filter and score packages
-    int filtered_indices[MAX_PACKAGES];
-    double filtered_scores[MAX_PACKAGES];
-    int filtered_count = 0;
+    while (1) {
+        pthread_mutex_lock(&queue_lock);
+        while (queue_count == 0) {
+            pthread_cond_wait(&queue_not_empty, &queue_lock);
+        }
+        // Take this worker's share of the backlog, so a burst is spread
+        // over the pool instead of queued behind one worker
+        int n = (queue_count + num_workers - 1) / num_workers;
+        if (n > SEND_BATCH) n = SEND_BATCH;
+        for (int i = 0; i < n; i++) {
+            reqs[i] = request_queue[queue_head];
+            queue_head = (queue_head + 1) % QUEUE_CAPACITY;
+        }
+        queue_count -= n;
+        pthread_cond_signal(&queue_not_full);
+        if (queue_count > 0) pthread_cond_signal(&queue_not_empty);
+        pthread_mutex_unlock(&queue_lock);
+        
+        // Pin the current catalogue for this batch (see worker_epochs)
+        __atomic_store_n(&worker_epochs[worker_id], __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+        const Catalogue* cat = __atomic_load_n(&current_catalogue, __ATOMIC_SEQ_CST);
+        
+        memset(msgs, 0, n * sizeof(struct mmsghdr));
+        for (int i = 0; i < n; i++) {
+            iovs[i].iov_base = responses[i];
+            iovs[i].iov_len = answer_request(cat, reqs[i].query, responses[i], BUFFER_SIZE);
+            msgs[i].msg_hdr.msg_name = &reqs[i].client;
+            msgs[i].msg_hdr.msg_namelen = reqs[i].client_len;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        __atomic_store_n(&worker_epochs[worker_id], 0, __ATOMIC_RELEASE);
+        
+        // Send responses back (sendmmsg on one UDP socket is safe from many
+        // threads); it may send fewer than asked, so continue from there
+        int sent = 0;
+        while (sent < n) {
+            STAT_ADD(stat_send_calls, 1);
+            int r = sendmmsg(sockfd, msgs + sent, n - sent, 0);
+            if (r < 0) {
+                if (errno == EINTR) continue;
+                sent++;   // drop the datagram that failed, keep the rest
+                continue;
+            }
+            sent += r;
+        }
+        for (int i = 0; i < n; i++) {
+            log_request("Sent response to client.\n\n");
+        }
+    }
     
-    for (int i = 0; i < total_packages; i++) {
-        if (matches_filter(i)) {
-            filtered_indices[filtered_count] = i;
-            filtered_scores[filtered_count] = calculate_score(i);
-            filtered_count++;
+    return NULL;
+}
+
+// Receiver side: append reqs[0..n) (query i is lengths[i] bytes plus its
+// NUL), waiting while the queue is full
+void enqueue_requests(const Request* reqs, const int* lengths, int n) {
+    pthread_mutex_lock(&queue_lock);
+    for (int i = 0; i < n; i++) {
+        while (queue_count == QUEUE_CAPACITY) {
+            pthread_cond_signal(&queue_not_empty);
+            pthread_cond_wait(&queue_not_full, &queue_lock);
         }
+        Request* slot = &request_queue[(queue_head + queue_count) % QUEUE_CAPACITY];
+        memcpy(slot->query, reqs[i].query, lengths[i] + 1);
+        slot->client = reqs[i].client;
+        slot->client_len = reqs[i].client_len;
+        queue_count++;
     }
+    pthread_cond_signal(&queue_not_empty);
+    pthread_mutex_unlock(&queue_lock);
+}
+
+// Load a dataset and build its indexes. NULL on failure.
+Catalogue* catalogue_load(const char* path, int num_threads, unsigned long version) {
+    Catalogue* cat = (Catalogue*)calloc(1, sizeof(Catalogue));
+    if (cat == NULL) return NULL;
+    if (snapshot_load_dataset(&cat->store, path, num_threads) != 0) {
+        free(cat);
+        return NULL;
+    }
+    if (index_build(&cat->index, &cat->store) != 0) {
+        store_free(&cat->store);
+        free(cat);
+        return NULL;
+    }
+    cat->version = version;
+    return cat;
+}
+
+void catalogue_free(Catalogue* cat) {
+    index_free(&cat->index);
+    store_free(&cat->store);
+    free(cat);
+}
+
+void handle_sighup(int sig) {
+    (void)sig;
+    reload_requested = 1;
+}
+
+// A replaced dataset file (written elsewhere and renamed over) gets a new
+// inode; one edited in place gets a new mtime or size
+int same_file_version(const struct stat* a, const struct stat* b) {
+    return a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+// Reload thread: on SIGHUP, or when the dataset file changes, build a new
+// catalogue (on this one thread, so the workers keep their CPUs), publish
+// it, wait out the workers still using the old one, then free it
+void* reload_main(void* arg) {
+    (void)arg;
+    struct stat loaded;
+    if (stat(dataset_file, &loaded) != 0) memset(&loaded, 0, sizeof(loaded));
     
-    // Sort to get TOPK
-    if (filtered_count > 0) {
-        sort_topk(filtered_indices, filtered_scores, filtered_count);
-        int topk_count = (filtered_count < query_topk) ? filtered_count : query_topk;
+    while (1) {
+        // Sleep in short steps so SIGHUP is noticed quickly
+        for (int waited = 0; waited < RELOAD_POLL_MS && !reload_requested; waited += 50) {
+            struct timespec step = { 0, 50 * 1000000L };
+            nanosleep(&step, NULL);
+        }
+        int requested = reload_requested;
+        reload_requested = 0;
         
-        // Format response
-        response[0] = '\0';
-        snprintf(response, response_size, "FOUND %d matching packages. TOP %d:\n", filtered_count, topk_count);
+        struct stat now;
+        if (stat(dataset_file, &now) != 0) continue;
+        if (!requested && same_file_version(&now, &loaded)) continue;
+        loaded = now;   // a failed load is retried when the file changes again
         
-        for (int i = 0; i < topk_count; i++) {
-            int idx = filtered_indices[i];
-            char line[512];
-            snprintf(line, sizeof(line),
-                    "%d. %s | %s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
-                    i + 1,
-                    package_ids[idx],
-                    place_names[idx],
-                    provinces[idx],
-                    categories[idx],
-                    duration_days[idx],
-                    avg_prices[idx],
-                    ratings[idx],
-                    filtered_scores[i]);
-            strncat(response, line, response_size - strlen(response) - 1);
+        Catalogue* old = current_catalogue;
+        struct timespec t0, t1;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        Catalogue* next = catalogue_load(dataset_file, 1, old->version + 1);
+        if (next == NULL) {
+            printf("Reload of %s failed; still serving version %lu.\n", dataset_file, old->version);
+            fflush(stdout);
+            continue;
         }
-    } else {
-        snprintf(response, response_size, "No packages match the query filters.\n");
+        
+        __atomic_store_n(&current_catalogue, next, __ATOMIC_SEQ_CST);
+        unsigned long epoch = __atomic_add_fetch(&global_epoch, 1, __ATOMIC_SEQ_CST);
+        for (int w = 0; w < num_workers; w++) {
+            while (1) {
+                unsigned long e = __atomic_load_n(&worker_epochs[w], __ATOMIC_SEQ_CST);
+                if (e == 0 || e >= epoch) break;
+                struct timespec pause = { 0, 1000000L };
+                nanosleep(&pause, NULL);
+            }
+        }
+        catalogue_free(old);
+        cache_invalidate(&response_cache);   // old entries are keyed by the old version
+        STAT_ADD(stat_reloads, 1);
+        
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        printf("Reloaded %s: %d packages (version %lu) in %.3f seconds.\n", dataset_file,
+               next->store.count, next->version, (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+        fflush(stdout);
     }
+    return NULL;
 }
 
 int main(int argc, char* argv[]) {
     if (argc < 3) {
-        printf("Usage: %s <port> <dataset_file>\n", argv[0]);
-        printf("Example: %s 8080 package_dataset_pakistan.txt\n", argv[0]);
+        printf("Usage: %s <port> <dataset_file> [num_workers] [log] [cache_entries]\n", argv[0]);
+        printf("Example: %s 8080 package_dataset_pakistan.txt 4\n", argv[0]);
+        printf("num_workers defaults to the number of CPUs.\n");
+        printf("log: 1 (default) logs every request, 0 turns request logging off.\n");
+        printf("cache_entries: responses kept for repeated queries (default %d, 0 disables).\n", CACHE_ENTRIES);
+        printf("The dataset is reloaded when the file changes or on SIGHUP; replace it by\n");
+        printf("writing a new file and renaming it over the old one.\n");
         return 1;
     }
     
     int port = atoi(argv[1]);
-    char* dataset_file = argv[2];
-    
-    // Load dataset
-    FILE* file = fopen(dataset_file, "r");
-    if (file == NULL) {
-        printf("Error: Cannot open file %s\n", dataset_file);
+    dataset_file = argv[2];
+    num_workers = (argc >= 4) ? atoi(argv[3]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers < 1) num_workers = 1;
+    log_enabled = (argc >= 5) ? atoi(argv[4]) != 0 : 1;
+    int cache_entries = (argc >= 6) ? atoi(argv[5]) : CACHE_ENTRIES;
+    if (cache_init(&response_cache, cache_entries, BUFFER_SIZE) != 0) {
+        printf("Error: Out of memory\n");
         return 1;
     }
     
-    char line[MAX_LINE_LENGTH];
+    // Load dataset (snapshot if fresh, else file chunks parsed on one thread per CPU)
     printf("Loading dataset from %s...\n", dataset_file);
-    
-    while (fgets(line, MAX_LINE_LENGTH, file) != NULL && total_packages < MAX_PACKAGES) {
-        char line_copy[MAX_LINE_LENGTH];
-        strcpy(line_copy, line);
-        if (parse_line(line_copy, total_packages)) {
-            total_packages++;
-        }
+    current_catalogue = catalogue_load(dataset_file, (int)sysconf(_SC_NPROCESSORS_ONLN), 1);
+    if (current_catalogue == NULL) {
+        printf("Error: Cannot open file %s\n", dataset_file);
+        return 1;
     }
+    printf("Loaded %d packages.\n", current_catalogue->store.count);
     
-    fclose(file);
-    printf("Loaded %d packages.\n", total_packages);
+    worker_epochs = (unsigned long*)calloc(num_workers, sizeof(unsigned long));
+    int* worker_ids = (int*)malloc(num_workers * sizeof(int));
+    if (worker_epochs == NULL || worker_ids == NULL) {
+        printf("Error: Out of memory\n");
+        return 1;
+    }
     
     // Create UDP socket
-    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
     if (sockfd < 0) {
         perror("Socket creation failed");
         exit(1);
     }
     
     // Server address setup
-    struct sockaddr_in servaddr, cliaddr;
-    socklen_t len;
-    
+    struct sockaddr_in servaddr;
+    memset(&servaddr, 0, sizeof(servaddr));
     servaddr.sin_family = AF_INET;
     servaddr.sin_addr.s_addr = INADDR_ANY;
     servaddr.sin_port = htons(port);
@@ -256,30 +587,102 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
     
-    printf("Server running on port %d. Waiting for queries...\n", port);
+    // Start the logger and the worker pool
+    pthread_t logger;
+    if (pthread_create(&logger, NULL, logger_main, NULL) != 0) {
+        printf("Error: Cannot start logger thread\n");
+        exit(1);
+    }
+    pthread_detach(logger);
+    for (int i = 0; i < num_workers; i++) {
+        pthread_t worker;
+        worker_ids[i] = i;
+        if (pthread_create(&worker, NULL, worker_main, &worker_ids[i]) != 0) {
+            printf("Error: Cannot start worker thread %d\n", i);
+            exit(1);
+        }
+        pthread_detach(worker);
+    }
+    
+    // Reload the dataset when it changes on disk or on SIGHUP
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_sighup;
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGHUP, &sa, NULL);
+    pthread_t reloader;
+    if (pthread_create(&reloader, NULL, reload_main, NULL) != 0) {
+        printf("Error: Cannot start reload thread\n");
+        exit(1);
+    }
+    pthread_detach(reloader);
+    
+    // Wait for datagrams with epoll; reads never block, so each wakeup
+    // drains everything queued on the socket
+    int epfd = epoll_create1(0);
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = sockfd;
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, sockfd, &ev) < 0) {
+        perror("epoll setup failed");
+        close(sockfd);
+        exit(1);
+    }
+    
+    printf("Server running on port %d with %d worker threads. Waiting for queries...\n", port, num_workers);
+    fflush(stdout);
+    
+    // Receive queries (UDP) on this thread, up to RECV_BATCH per recvmmsg,
+    // and hand them to the workers
+    static Request rx[RECV_BATCH];
+    struct mmsghdr msgs[RECV_BATCH];
+    struct iovec iovs[RECV_BATCH];
+    int lengths[RECV_BATCH];
+    char client_ip[INET_ADDRSTRLEN];
     
-    // Receive queries (UDP)
     while (1) {
-        char buffer[BUFFER_SIZE];
-        len = sizeof(cliaddr);
-        int n = recvfrom(sockfd, buffer, BUFFER_SIZE - 1, 0,
-                        (struct sockaddr*)&cliaddr, &len);
-        if (n > 0) {
-            buffer[n] = '\0';
-            printf("Received from client %s:%d: %s\n", 
-                   inet_ntoa(cliaddr.sin_addr), ntohs(cliaddr.sin_port), buffer);
-            
-            // Process query
-            char response[BUFFER_SIZE];
-            process_query_and_format(buffer, response, BUFFER_SIZE);
+        struct epoll_event ready;
+        STAT_ADD(stat_epoll_waits, 1);
+        if (epoll_wait(epfd, &ready, 1, -1) < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait failed");
+            break;
+        }
+        
+        while (1) {
+            memset(msgs, 0, sizeof(msgs));
+            for (int i = 0; i < RECV_BATCH; i++) {
+                iovs[i].iov_base = rx[i].query;
+                iovs[i].iov_len = BUFFER_SIZE - 1;
+                msgs[i].msg_hdr.msg_name = &rx[i].client;
+                msgs[i].msg_hdr.msg_namelen = sizeof(rx[i].client);
+                msgs[i].msg_hdr.msg_iov = &iovs[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            STAT_ADD(stat_recv_calls, 1);
+            int n = recvmmsg(sockfd, msgs, RECV_BATCH, MSG_DONTWAIT, NULL);
+            if (n <= 0) break;   // EAGAIN: drained
             
-            // Send response back
-            sendto(sockfd, response, strlen(response), 0,
-                  (struct sockaddr*)&cliaddr, len);
-            printf("Sent response to client.\n\n");
+            int count = 0;
+            for (int i = 0; i < n; i++) {
+                int length = (int)msgs[i].msg_len;
+                if (length <= 0) continue;
+                rx[i].query[length] = '\0';
+                rx[i].client_len = msgs[i].msg_hdr.msg_namelen;
+                if (log_enabled) {
+                    inet_ntop(AF_INET, &rx[i].client.sin_addr, client_ip, sizeof(client_ip));
+                    log_request("Received from client %s:%d: %s\n",
+                                client_ip, ntohs(rx[i].client.sin_port), rx[i].query);
+                }
+                if (count != i) rx[count] = rx[i];
+                lengths[count++] = length;
+            }
+            enqueue_requests(rx, lengths, count);
         }
     }
     
+    close(epfd);
     close(sockfd);
     return 0;
 }
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "snapshot.h"
+
+#define SNAPSHOT_MAGIC "WHSNAP01"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ALIGN 64
+#define SAMPLE_BYTES (64 * 1024)
+
+// Column blocks, in file order
+enum {
+    BLOCK_PACKAGE_IDS,
+    BLOCK_PLACE_NAMES,
+    BLOCK_PROVINCE_CODES,
+    BLOCK_CATEGORY_CODES,
+    BLOCK_DURATION_DAYS,
+    BLOCK_AVG_PRICES,
+    BLOCK_RATINGS,
+    BLOCK_REVIEWS_COUNTS,
+    BLOCK_POPULARITY_SCORES,
+    BLOCK_BASE_SCORES,
+    BLOCK_TEXT,
+    BLOCK_PROVINCE_DICT,
+    BLOCK_CATEGORY_DICT,
+    NUM_BLOCKS
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t row_count;
+
+    // Identity of the TSV this snapshot was built from
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    uint64_t source_checksum;
+
+    uint64_t block_offset[NUM_BLOCKS];
+    uint64_t block_length[NUM_BLOCKS];
+} SnapshotHeader;
+
+// ---------------- Source fingerprint ----------------
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Checksum over the size, mtime and the first and last SAMPLE_BYTES of the
+// source. Hashing the whole file would cost as much as parsing it.
+static int source_fingerprint(const char* path, SnapshotHeader* h) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    h->source_size = (uint64_t)st.st_size;
+    h->source_mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    h->source_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+
+    uint64_t hash = 14695981039346656037ULL;
+    hash = fnv1a(hash, &h->source_size, sizeof(h->source_size));
+    hash = fnv1a(hash, &h->source_mtime_sec, sizeof(h->source_mtime_sec));
+    hash = fnv1a(hash, &h->source_mtime_nsec, sizeof(h->source_mtime_nsec));
+
+    char* buf = (char*)malloc(SAMPLE_BYTES);
+    if (buf == NULL) {
+        close(fd);
+        return -1;
+    }
+
+    ssize_t n = pread(fd, buf, SAMPLE_BYTES, 0);
+    if (n > 0) hash = fnv1a(hash, buf, (size_t)n);
+
+    if (st.st_size > SAMPLE_BYTES) {
+        n = pread(fd, buf, SAMPLE_BYTES, st.st_size - SAMPLE_BYTES);
+        if (n > 0) hash = fnv1a(hash, buf, (size_t)n);
+    }
+
+    free(buf);
+    close(fd);
+    h->source_checksum = hash;
+    return 0;
+}
+
+// ---------------- Writing ----------------
+
+static int write_padding(FILE* f, uint64_t* pos) {
+    static const char zeros[SNAPSHOT_ALIGN] = { 0 };
+    uint64_t pad = (SNAPSHOT_ALIGN - (*pos % SNAPSHOT_ALIGN)) % SNAPSHOT_ALIGN;
+    if (pad > 0 && fwrite(zeros, 1, pad, f) != pad) return -1;
+    *pos += pad;
+    return 0;
+}
+
+static int write_block(FILE* f, uint64_t* pos, SnapshotHeader* h, int block,
+                       const void* data, uint64_t len) {
+    if (write_padding(f, pos) != 0) return -1;
+    h->block_offset[block] = *pos;
+    h->block_length[block] = len;
+    if (len > 0 && fwrite(data, 1, len, f) != len) return -1;
+    *pos += len;
+    return 0;
+}
+
+static int write_dict_block(FILE* f, uint64_t* pos, SnapshotHeader* h, int block,
+                            const StringDict* d) {
+    if (write_padding(f, pos) != 0) return -1;
+    h->block_offset[block] = *pos;
+    for (int i = 0; i < d->count; i++) {
+        if (fwrite(d->values[i], 1, d->lengths[i] + 1, f) != (size_t)d->lengths[i] + 1) return -1;
+        *pos += d->lengths[i] + 1;
+    }
+    h->block_length[block] = *pos - h->block_offset[block];
+    return 0;
+}
+
+// A view as written to the file, with the struct padding zeroed
+static StrRef file_ref(size_t offset, int length) {
+    StrRef ref;
+    memset(&ref, 0, sizeof(ref));
+    ref.offset = offset;
+    ref.length = length;
+    return ref;
+}
+
+// The store's text is usually the whole TSV; the snapshot keeps only the
+// id and name bytes, laid out row by row, and rewrites the views to match.
+static int write_string_blocks(FILE* f, uint64_t* pos, SnapshotHeader* h, const PackageStore* s) {
+    size_t text_offset = 0;
+
+    if (write_padding(f, pos) != 0) return -1;
+    h->block_offset[BLOCK_PACKAGE_IDS] = *pos;
+    for (int i = 0; i < s->count; i++) {
+        StrRef ref = file_ref(text_offset, s->package_ids[i].length);
+        if (fwrite(&ref, sizeof(ref), 1, f) != 1) return -1;
+        text_offset += s->package_ids[i].length + s->place_names[i].length;
+    }
+    h->block_length[BLOCK_PACKAGE_IDS] = (uint64_t)s->count * sizeof(StrRef);
+    *pos += h->block_length[BLOCK_PACKAGE_IDS];
+
+    text_offset = 0;
+    if (write_padding(f, pos) != 0) return -1;
+    h->block_offset[BLOCK_PLACE_NAMES] = *pos;
+    for (int i = 0; i < s->count; i++) {
+        StrRef ref = file_ref(text_offset + s->package_ids[i].length, s->place_names[i].length);
+        if (fwrite(&ref, sizeof(ref), 1, f) != 1) return -1;
+        text_offset += s->package_ids[i].length + s->place_names[i].length;
+    }
+    h->block_length[BLOCK_PLACE_NAMES] = (uint64_t)s->count * sizeof(StrRef);
+    *pos += h->block_length[BLOCK_PLACE_NAMES];
+
+    if (write_padding(f, pos) != 0) return -1;
+    h->block_offset[BLOCK_TEXT] = *pos;
+    for (int i = 0; i < s->count; i++) {
+        const StrRef* id = &s->package_ids[i];
+        const StrRef* name = &s->place_names[i];
+        if (fwrite(s->text + id->offset, 1, id->length, f) != (size_t)id->length) return -1;
+        if (fwrite(s->text + name->offset, 1, name->length, f) != (size_t)name->length) return -1;
+    }
+    h->block_length[BLOCK_TEXT] = text_offset;
+    *pos += text_offset;
+    return 0;
+}
+
+int snapshot_write(const PackageStore* s, const char* source_path, const char* snapshot_path) {
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.header_size = sizeof(h);
+    h.row_count = (uint64_t)s->count;
+    if (source_fingerprint(source_path, &h) != 0) return -1;
+
+    // Write to a temporary name and rename, so readers never see a partial file
+    size_t path_len = strlen(snapshot_path);
+    char* tmp_path = (char*)malloc(path_len + 5);
+    if (tmp_path == NULL) return -1;
+    snprintf(tmp_path, path_len + 5, "%s.tmp", snapshot_path);
+
+    FILE* f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        free(tmp_path);
+        return -1;
+    }
+
+    uint64_t n = (uint64_t)s->count;
+    uint64_t pos = sizeof(h);
+    int rc = (fwrite(&h, sizeof(h), 1, f) == 1) ? 0 : -1;
+
+    if (rc == 0) rc = write_string_blocks(f, &pos, &h, s);
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_PROVINCE_CODES, s->province_codes, n);
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_CATEGORY_CODES, s->category_codes, n);
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_DURATION_DAYS, s->duration_days, n * sizeof(int));
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_AVG_PRICES, s->avg_prices, n * sizeof(double));
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_RATINGS, s->ratings, n * sizeof(double));
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_REVIEWS_COUNTS, s->reviews_counts, n * sizeof(int));
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_POPULARITY_SCORES, s->popularity_scores, n * sizeof(double));
+    if (rc == 0) rc = write_block(f, &pos, &h, BLOCK_BASE_SCORES, s->base_scores, n * sizeof(double));
+    if (rc == 0) rc = write_dict_block(f, &pos, &h, BLOCK_PROVINCE_DICT, &s->province_dict);
+    if (rc == 0) rc = write_dict_block(f, &pos, &h, BLOCK_CATEGORY_DICT, &s->category_dict);
+
+    // Header last, now that the block table is filled in
+    if (rc == 0 && fseek(f, 0, SEEK_SET) != 0) rc = -1;
+    if (rc == 0 && fwrite(&h, sizeof(h), 1, f) != 1) rc = -1;
+    if (fclose(f) != 0) rc = -1;
+
+    if (rc == 0 && rename(tmp_path, snapshot_path) != 0) rc = -1;
+    if (rc != 0) unlink(tmp_path);
+
+    free(tmp_path);
+    return rc;
+}
+
+// ---------------- Reading ----------------
+
+// Every view of refs[0..n) lies inside a text block of text_len bytes. The
+// fingerprint only proves the TSV is unchanged, not that the snapshot is
+// intact, and "%.*s" would read wherever a damaged view points.
+static int refs_valid(const StrRef* refs, uint64_t n, uint64_t text_len) {
+    for (uint64_t i = 0; i < n; i++) {
+        if (refs[i].length < 0 || refs[i].offset > text_len ||
+            (uint64_t)refs[i].length > text_len - refs[i].offset) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int load_dict_block(StringDict* d, const char* block, uint64_t len) {
+    const char* end = block + len;
+    for (const char* p = block; p < end; ) {
+        const char* nul = (const char*)memchr(p, '\0', end - p);
+        if (nul == NULL || dict_intern(d, p, (int)(nul - p)) < 0) return -1;
+        p = nul + 1;
+    }
+    return 0;
+}
+
+int snapshot_open(PackageStore* s, const char* source_path, const char* snapshot_path) {
+    SnapshotHeader source;
+    if (source_fingerprint(source_path, &source) != 0) return -1;
+
+    int fd = open(snapshot_path, O_RDONLY);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char* map = (char*)mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+
+    const SnapshotHeader* h = (const SnapshotHeader*)map;
+    uint64_t n = h->row_count;
+
+    int ok = memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) == 0 &&
+             h->version == SNAPSHOT_VERSION &&
+             h->header_size == sizeof(SnapshotHeader) &&
+             n <= (uint64_t)0x7fffffff &&
+             h->source_size == source.source_size &&
+             h->source_mtime_sec == source.source_mtime_sec &&
+             h->source_mtime_nsec == source.source_mtime_nsec &&
+             h->source_checksum == source.source_checksum;
+
+    for (int b = 0; ok && b < NUM_BLOCKS; b++) {
+        ok = h->block_offset[b] % SNAPSHOT_ALIGN == 0 &&
+             h->block_offset[b] + h->block_length[b] <= size;
+    }
+    ok = ok && h->block_length[BLOCK_PACKAGE_IDS] == n * sizeof(StrRef) &&
+               h->block_length[BLOCK_PLACE_NAMES] == n * sizeof(StrRef) &&
+               h->block_length[BLOCK_PROVINCE_CODES] == n &&
+               h->block_length[BLOCK_CATEGORY_CODES] == n &&
+               h->block_length[BLOCK_DURATION_DAYS] == n * sizeof(int) &&
+               h->block_length[BLOCK_AVG_PRICES] == n * sizeof(double) &&
+               h->block_length[BLOCK_RATINGS] == n * sizeof(double) &&
+               h->block_length[BLOCK_REVIEWS_COUNTS] == n * sizeof(int) &&
+               h->block_length[BLOCK_POPULARITY_SCORES] == n * sizeof(double) &&
+               h->block_length[BLOCK_BASE_SCORES] == n * sizeof(double) &&
+               refs_valid((const StrRef*)(map + h->block_offset[BLOCK_PACKAGE_IDS]), n,
+                          h->block_length[BLOCK_TEXT]) &&
+               refs_valid((const StrRef*)(map + h->block_offset[BLOCK_PLACE_NAMES]), n,
+                          h->block_length[BLOCK_TEXT]);
+
+    if (!ok) {
+        munmap(map, size);
+        return -1;
+    }
+
+    store_init(s);
+    s->count = (int)n;
+    s->capacity = (int)n;
+    s->package_ids = (StrRef*)(map + h->block_offset[BLOCK_PACKAGE_IDS]);
+    s->place_names = (StrRef*)(map + h->block_offset[BLOCK_PLACE_NAMES]);
+    s->province_codes = (unsigned char*)(map + h->block_offset[BLOCK_PROVINCE_CODES]);
+    s->category_codes = (unsigned char*)(map + h->block_offset[BLOCK_CATEGORY_CODES]);
+    s->duration_days = (int*)(map + h->block_offset[BLOCK_DURATION_DAYS]);
+    s->avg_prices = (double*)(map + h->block_offset[BLOCK_AVG_PRICES]);
+    s->ratings = (double*)(map + h->block_offset[BLOCK_RATINGS]);
+    s->reviews_counts = (int*)(map + h->block_offset[BLOCK_REVIEWS_COUNTS]);
+    s->popularity_scores = (double*)(map + h->block_offset[BLOCK_POPULARITY_SCORES]);
+    s->base_scores = (double*)(map + h->block_offset[BLOCK_BASE_SCORES]);
+    s->text = map + h->block_offset[BLOCK_TEXT];
+    s->text_len = h->block_length[BLOCK_TEXT];
+    s->text_capacity = s->text_len;
+    s->snapshot_map = map;
+    s->snapshot_size = size;
+
+    if (load_dict_block(&s->province_dict, map + h->block_offset[BLOCK_PROVINCE_DICT],
+                        h->block_length[BLOCK_PROVINCE_DICT]) != 0 ||
+        load_dict_block(&s->category_dict, map + h->block_offset[BLOCK_CATEGORY_DICT],
+                        h->block_length[BLOCK_CATEGORY_DICT]) != 0) {
+        store_free(s);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------- Load with snapshot cache ----------------
+
+int snapshot_load_dataset(PackageStore* s, const char* tsv_path, int num_threads) {
+    size_t path_len = strlen(tsv_path);
+    char* snap_path = (char*)malloc(path_len + sizeof(SNAPSHOT_SUFFIX));
+    if (snap_path == NULL) return -1;
+    snprintf(snap_path, path_len + sizeof(SNAPSHOT_SUFFIX), "%s%s", tsv_path, SNAPSHOT_SUFFIX);
+
+    if (snapshot_open(s, tsv_path, snap_path) == 0) {
+        free(snap_path);
+        return 0;
+    }
+
+    int rc = store_load_tsv_parallel(s, tsv_path, num_threads);
+
+    // Best effort: a read-only directory just means no snapshot next time
+    if (rc == 0) snapshot_write(s, tsv_path, snap_path);
+
+    free(snap_path);
+    return rc;
+}
@@ -0,0 +1,35 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include "package_store.h"
+
+// Binary columnar snapshot of a PackageStore.
+//
+// Layout: a fixed header followed by one 64-byte aligned block per column
+// (the raw column arrays, a compact text block holding only package ids and
+// place names, and the two dictionaries as NUL-separated values). Opening a
+// snapshot maps the file and points the store's columns straight into the
+// mapping, so start-up does no parsing; the only per-row work is checking
+// that every string view lies inside the text block.
+//
+// The header records the size, mtime and a sampled checksum of the TSV it
+// was built from; a snapshot whose source no longer matches is stale and
+// is rejected. Snapshots are host-endian and meant for the machine (or
+// identical machines) that wrote them.
+
+#define SNAPSHOT_SUFFIX ".snap"
+
+// Write s (loaded from source_path) to snapshot_path. 0 or -1.
+int snapshot_write(const PackageStore* s, const char* source_path, const char* snapshot_path);
+
+// Map snapshot_path into an empty store. Fails (-1) if the file is missing,
+// malformed (including a string view outside the text), from another
+// format version, or stale against source_path.
+int snapshot_open(PackageStore* s, const char* source_path, const char* snapshot_path);
+
+// Load a dataset for serving: use "<tsv_path>.snap" when it is fresh,
+// otherwise parse the TSV (on num_threads threads) and try to write the
+// snapshot for next time. 0 or -1, like store_load_tsv().
+int snapshot_load_dataset(PackageStore* s, const char* tsv_path, int num_threads);
+
+#endif
@@ -0,0 +1,53 @@
+#include <stdlib.h>
+#include <string.h>
+#include "string_dict.h"
+
+void dict_init(StringDict* d) {
+    memset(d, 0, sizeof(*d));
+}
+
+void dict_free(StringDict* d) {
+    for (int i = 0; i < d->count; i++) {
+        free(d->values[i]);
+    }
+    dict_init(d);
+}
+
+int dict_intern(StringDict* d, const char* value, int length) {
+    // Only a handful of distinct values, so a linear scan is enough
+    for (int i = 0; i < d->count; i++) {
+        if (d->lengths[i] == length && memcmp(d->values[i], value, length) == 0) {
+            return i;
+        }
+    }
+
+    if (d->count >= DICT_MAX_VALUES) return -1;
+
+    char* copy = (char*)malloc(length + 1);
+    if (copy == NULL) return -1;
+    memcpy(copy, value, length);
+    copy[length] = '\0';
+
+    d->values[d->count] = copy;
+    d->lengths[d->count] = length;
+    return d->count++;
+}
+
+int dict_lookup(const StringDict* d, const char* value) {
+    for (int i = 0; i < d->count; i++) {
+        if (strcmp(d->values[i], value) == 0) return i;
+    }
+    return -1;
+}
+
+int dict_query_code(const StringDict* d, const char* value) {
+    if (value[0] == '\0') return DICT_ANY;
+
+    int code = dict_lookup(d, value);
+    return (code >= 0) ? code : DICT_NONE;
+}
+
+const char* dict_value(const StringDict* d, int code) {
+    if (code < 0 || code >= d->count) return "";
+    return d->values[code];
+}
@@ -0,0 +1,35 @@
+#ifndef STRING_DICT_H
+#define STRING_DICT_H
+
+// Small string-interning dictionary for low-cardinality columns (province,
+// category). Each distinct value gets a one-byte code in load order, so a
+// column stores one byte per row and filters compare integers.
+
+#define DICT_MAX_VALUES 255
+
+// Query codes that are not real values
+#define DICT_ANY (-1)                 // no filter on this column
+#define DICT_NONE DICT_MAX_VALUES     // value not in the dataset: matches no row
+
+typedef struct {
+    int count;
+    char* values[DICT_MAX_VALUES];    // NUL-terminated copies
+    int lengths[DICT_MAX_VALUES];
+} StringDict;
+
+void dict_init(StringDict* d);
+void dict_free(StringDict* d);
+
+// Code for value[0..length), adding it if new. -1 if the dictionary is full
+// or out of memory.
+int dict_intern(StringDict* d, const char* value, int length);
+
+// Code for a NUL-terminated value, or -1 if it was never interned
+int dict_lookup(const StringDict* d, const char* value);
+
+// Resolve a query value: DICT_ANY for "", DICT_NONE if unknown
+int dict_query_code(const StringDict* d, const char* value);
+
+const char* dict_value(const StringDict* d, int code);
+
+#endif
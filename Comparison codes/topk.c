@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include "topk.h"
+
+// a ranks below b: lower score, or same score and later package index
+static int ranks_below(double score_a, int index_a, double score_b, int index_b) {
+    if (score_a != score_b) return score_a < score_b;
+    return index_a > index_b;
+}
+
+static void swap_entries(TopK* t, int a, int b) {
+    double ts = t->scores[a];
+    t->scores[a] = t->scores[b];
+    t->scores[b] = ts;
+
+    int ti = t->indices[a];
+    t->indices[a] = t->indices[b];
+    t->indices[b] = ti;
+}
+
+// Heap root holds the worst kept entry
+static void sift_down(TopK* t, int pos, int count) {
+    while (1) {
+        int left = 2 * pos + 1;
+        int right = left + 1;
+        int worst = pos;
+
+        if (left < count && ranks_below(t->scores[left], t->indices[left],
+                                         t->scores[worst], t->indices[worst])) {
+            worst = left;
+        }
+        if (right < count && ranks_below(t->scores[right], t->indices[right],
+                                          t->scores[worst], t->indices[worst])) {
+            worst = right;
+        }
+        if (worst == pos) return;
+
+        swap_entries(t, pos, worst);
+        pos = worst;
+    }
+}
+
+static void sift_up(TopK* t, int pos) {
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (!ranks_below(t->scores[pos], t->indices[pos],
+                         t->scores[parent], t->indices[parent])) {
+            return;
+        }
+        swap_entries(t, pos, parent);
+        pos = parent;
+    }
+}
+
+int topk_init(TopK* t, int k) {
+    t->capacity = (k > 0) ? k : 0;
+    t->count = 0;
+    t->indices = NULL;
+    t->scores = NULL;
+
+    if (t->capacity == 0) return 0;
+
+    t->indices = (int*)malloc(t->capacity * sizeof(int));
+    t->scores = (double*)malloc(t->capacity * sizeof(double));
+    if (t->indices == NULL || t->scores == NULL) {
+        topk_free(t);
+        return -1;
+    }
+    return 0;
+}
+
+void topk_free(TopK* t) {
+    free(t->indices);
+    free(t->scores);
+    t->indices = NULL;
+    t->scores = NULL;
+    t->capacity = 0;
+    t->count = 0;
+}
+
+void topk_reset(TopK* t) {
+    t->count = 0;
+}
+
+void topk_push(TopK* t, int index, double score) {
+    if (t->count < t->capacity) {
+        t->indices[t->count] = index;
+        t->scores[t->count] = score;
+        sift_up(t, t->count);
+        t->count++;
+        return;
+    }
+
+    // Full: replace the current worst only if the candidate beats it
+    if (t->capacity > 0 && ranks_below(t->scores[0], t->indices[0], score, index)) {
+        t->indices[0] = index;
+        t->scores[0] = score;
+        sift_down(t, 0, t->count);
+    }
+}
+
+void topk_merge(TopK* dst, const TopK* src) {
+    for (int i = 0; i < src->count; i++) {
+        topk_push(dst, src->indices[i], src->scores[i]);
+    }
+}
+
+int topk_sort(TopK* t) {
+    // Heap sort: repeatedly move the worst entry to the end
+    for (int end = t->count - 1; end > 0; end--) {
+        swap_entries(t, 0, end);
+        sift_down(t, 0, end);
+    }
+    return t->count;
+}
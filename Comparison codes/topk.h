@@ -0,0 +1,34 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+// Bounded top-K selection shared by all recommenders.
+//
+// Keeps the best K (score, package index) pairs seen so far in a fixed-size
+// min-heap, so selecting from n candidates costs O(n log K) instead of the
+// O(n^2) bubble sort over every match. Ranking is by score (descending);
+// equal scores are ordered by package index (ascending), which is the same
+// order the old stable bubble sort produced for rows scanned in file order.
+
+typedef struct {
+    int capacity;     // K (0 means keep nothing)
+    int count;        // entries currently held
+    int* indices;
+    double* scores;
+} TopK;
+
+int topk_init(TopK* t, int k);
+void topk_free(TopK* t);
+void topk_reset(TopK* t);
+
+// Offer one candidate; it is kept only if it ranks inside the current top K.
+void topk_push(TopK* t, int index, double score);
+
+// Offer every entry of src to dst (used to merge per-worker results).
+void topk_merge(TopK* dst, const TopK* src);
+
+// Sort the held entries best-first in place and return how many there are.
+// After this call the entries are no longer a heap: read them, merge them
+// into another TopK, or topk_reset() before pushing again.
+int topk_sort(TopK* t);
+
+#endif
@@ -0,0 +1,187 @@
+// udp_loadgen.c
+// Closed-loop load generator for server_udp: each client thread sends a
+// burst of queries (1 by default), waits for their replies, and repeats,
+// cycling through a fixed mix of narrow and broad queries. Reports
+// queries/sec, latency (per burst), and the server's syscalls per query,
+// read from its STATS counters before and after the run.
+// Build: gcc -O2 udp_loadgen.c -o udp_loadgen -pthread
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define BUFFER_SIZE 4096
+#define MAX_CLIENTS 256
+#define MAX_BURST 256
+#define REPLY_TIMEOUT_MS 1000
+
+static const char* query_mix[] = {
+    "TOPK=5",
+    "PROVINCE=Punjab;CATEGORY=Nature;TOPK=3",
+    "PROVINCE=Sindh;TOPK=20",
+    "CATEGORY=Beach;BUDGET_MIN=10000;BUDGET_MAX=12000;TOPK=10",
+    "BUDGET_MAX=30000;DAYS=3;MIN_RATING=4.0;TOPK=7",
+    "MIN_RATING=4.5;TOPK=100",
+};
+
+typedef struct {
+    int id;
+    long long completed;
+    long long timeouts;
+    double latency_sum;
+    double latency_max;
+} ClientStats;
+
+struct sockaddr_in server_addr;
+double stop_time;
+int burst = 1;
+
+double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void* client_main(void* arg) {
+    ClientStats* st = (ClientStats*)arg;
+    int num_queries = (int)(sizeof(query_mix) / sizeof(query_mix[0]));
+
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("Socket creation failed");
+        return NULL;
+    }
+    struct timeval tv = { REPLY_TIMEOUT_MS / 1000, (REPLY_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buffer[BUFFER_SIZE];
+    int next = st->id % num_queries;   // clients start at different queries
+
+    while (now_seconds() < stop_time) {
+        double t0 = now_seconds();
+        for (int i = 0; i < burst; i++) {
+            const char* q = query_mix[next];
+            next = (next + 1) % num_queries;
+            sendto(sock, q, strlen(q), 0, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        }
+
+        // Replies may arrive in any order; a timeout gives up on the rest
+        int received = 0;
+        while (received < burst) {
+            int n = recvfrom(sock, buffer, BUFFER_SIZE - 1, 0, NULL, NULL);
+            if (n <= 0) break;
+            received++;
+        }
+        double t1 = now_seconds();
+
+        st->timeouts += burst - received;
+        if (received == 0) continue;
+        st->completed += received;
+        st->latency_sum += (t1 - t0) * received;
+        if (t1 - t0 > st->latency_max) st->latency_max = t1 - t0;
+    }
+
+    close(sock);
+    return NULL;
+}
+
+// Ask the server for its counters. Returns 0, or -1 if it did not answer.
+int read_server_stats(long long* queries, long long* epoll_waits, long long* recv_calls, long long* send_calls) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) return -1;
+    struct timeval tv = { REPLY_TIMEOUT_MS / 1000, (REPLY_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    char buffer[BUFFER_SIZE];
+    sendto(sock, "STATS", 5, 0, (struct sockaddr*)&server_addr, sizeof(server_addr));
+    int n = recvfrom(sock, buffer, BUFFER_SIZE - 1, 0, NULL, NULL);
+    close(sock);
+    if (n <= 0) return -1;
+    buffer[n] = '\0';
+    if (sscanf(buffer, "STATS queries=%lld epoll_waits=%lld recv_calls=%lld send_calls=%lld",
+               queries, epoll_waits, recv_calls, send_calls) != 4) return -1;
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printf("Usage: %s <server_port> [clients] [seconds] [server_ip] [burst]\n", argv[0]);
+        printf("Example: %s 8080 16 5\n", argv[0]);
+        printf("burst: queries each client sends before waiting for replies (default 1)\n");
+        return 1;
+    }
+
+    int port = atoi(argv[1]);
+    int clients = (argc >= 3) ? atoi(argv[2]) : 8;
+    double seconds = (argc >= 4) ? atof(argv[3]) : 5.0;
+    const char* server_ip = (argc >= 5) ? argv[4] : "127.0.0.1";
+    if (clients < 1) clients = 1;
+    if (clients > MAX_CLIENTS) clients = MAX_CLIENTS;
+    if (seconds <= 0.0) seconds = 5.0;
+    burst = (argc >= 6) ? atoi(argv[5]) : 1;
+    if (burst < 1) burst = 1;
+    if (burst > MAX_BURST) burst = MAX_BURST;
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, server_ip, &server_addr.sin_addr) <= 0) {
+        printf("Invalid IP address: %s\n", server_ip);
+        return 1;
+    }
+
+    long long q0 = 0, e0 = 0, r0 = 0, s0 = 0;
+    int have_stats = (read_server_stats(&q0, &e0, &r0, &s0) == 0);
+
+    printf("Sending to %s:%d from %d clients (bursts of %d) for %.1f seconds...\n",
+           server_ip, port, clients, burst, seconds);
+
+    ClientStats stats[MAX_CLIENTS];
+    pthread_t threads[MAX_CLIENTS];
+    memset(stats, 0, sizeof(stats));
+
+    double start = now_seconds();
+    stop_time = start + seconds;
+    int started = 0;
+    for (; started < clients; started++) {
+        stats[started].id = started;
+        if (pthread_create(&threads[started], NULL, client_main, &stats[started]) != 0) break;
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = now_seconds() - start;
+
+    long long completed = 0;
+    long long timeouts = 0;
+    double latency_sum = 0.0;
+    double latency_max = 0.0;
+    for (int i = 0; i < started; i++) {
+        completed += stats[i].completed;
+        timeouts += stats[i].timeouts;
+        latency_sum += stats[i].latency_sum;
+        if (stats[i].latency_max > latency_max) latency_max = stats[i].latency_max;
+    }
+
+    printf("Completed: %lld queries (%lld timeouts)\n", completed, timeouts);
+    printf("Throughput: %.0f queries/sec\n", completed / elapsed);
+    if (completed > 0) {
+        printf("Latency: avg %.3f ms, max %.3f ms\n",
+               latency_sum / completed * 1000.0, latency_max * 1000.0);
+    }
+
+    long long q1, e1, r1, s1;
+    if (have_stats && read_server_stats(&q1, &e1, &r1, &s1) == 0 && q1 > q0) {
+        double nq = (double)(q1 - q0);
+        printf("Server syscalls per query: %.3f (epoll_wait %.3f, recvmmsg %.3f, sendmmsg %.3f)\n",
+               ((e1 - e0) + (r1 - r0) + (s1 - s0)) / nq, (e1 - e0) / nq, (r1 - r0) / nq, (s1 - s0) / nq);
+    }
+    return 0;
+}
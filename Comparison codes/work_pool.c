@@ -0,0 +1,185 @@
+#define _GNU_SOURCE   // sched_setaffinity / CPU_SET
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "work_pool.h"
+
+typedef struct {
+    WorkPool* pool;
+    int id;
+    int cpu;      // -1: not pinned
+} WorkerArg;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Next chunk from the front of d, or -1
+static int take_front(PoolDeque* d) {
+    pthread_mutex_lock(&d->lock);
+    int chunk = (d->head < d->tail) ? d->chunks[d->head++] : -1;
+    pthread_mutex_unlock(&d->lock);
+    return chunk;
+}
+
+// Last chunk from the back of d, or -1
+static int take_back(PoolDeque* d) {
+    pthread_mutex_lock(&d->lock);
+    int chunk = (d->head < d->tail) ? d->chunks[--d->tail] : -1;
+    pthread_mutex_unlock(&d->lock);
+    return chunk;
+}
+
+static void run_job(WorkPool* p, int id, PoolTask task, void* ctx) {
+    PoolWorkerStats* st = &p->stats[id];
+    while (1) {
+        int chunk = take_front(&p->deques[id]);
+        int stolen = 0;
+        // Own deque empty: sweep the others, starting with the next worker
+        for (int k = 1; chunk < 0 && k < p->num_workers; k++) {
+            chunk = take_back(&p->deques[(id + k) % p->num_workers]);
+            stolen = 1;
+        }
+        if (chunk < 0) return;
+
+        double t0 = now_seconds();
+        task(ctx, id, chunk);
+        st->busy_seconds += now_seconds() - t0;
+        st->chunks++;
+        st->stolen += stolen;
+    }
+}
+
+static void* worker_main(void* arg) {
+    WorkPool* p = ((WorkerArg*)arg)->pool;
+    int id = ((WorkerArg*)arg)->id;
+    int cpu = ((WorkerArg*)arg)->cpu;
+    free(arg);
+
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);   // best effort
+    }
+
+    unsigned long seen = 0;
+    while (1) {
+        pthread_mutex_lock(&p->lock);
+        while (p->job == seen && !p->stopping) {
+            pthread_cond_wait(&p->job_ready, &p->lock);
+        }
+        if (p->stopping) {
+            pthread_mutex_unlock(&p->lock);
+            return NULL;
+        }
+        seen = p->job;
+        PoolTask task = p->task;
+        void* ctx = p->ctx;
+        pthread_mutex_unlock(&p->lock);
+
+        run_job(p, id, task, ctx);
+
+        pthread_mutex_lock(&p->lock);
+        if (--p->running == 0) pthread_cond_signal(&p->job_done);
+        pthread_mutex_unlock(&p->lock);
+    }
+}
+
+int pool_start(WorkPool* p, int num_workers, const int* cpus) {
+    memset(p, 0, sizeof(*p));
+    if (num_workers < 1) num_workers = 1;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->job_ready, NULL);
+    pthread_cond_init(&p->job_done, NULL);
+
+    p->threads = (pthread_t*)calloc(num_workers, sizeof(pthread_t));
+    p->deques = (PoolDeque*)calloc(num_workers, sizeof(PoolDeque));
+    p->stats = (PoolWorkerStats*)calloc(num_workers, sizeof(PoolWorkerStats));
+    if (p->threads == NULL || p->deques == NULL || p->stats == NULL) {
+        pool_stop(p);
+        return -1;
+    }
+    for (int i = 0; i < num_workers; i++) {
+        pthread_mutex_init(&p->deques[i].lock, NULL);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        WorkerArg* arg = (WorkerArg*)malloc(sizeof(WorkerArg));
+        if (arg != NULL) {
+            arg->pool = p;
+            arg->id = i;
+            arg->cpu = (cpus != NULL) ? cpus[i] : -1;
+        }
+        if (arg == NULL || pthread_create(&p->threads[i], NULL, worker_main, arg) != 0) {
+            free(arg);
+            pool_stop(p);
+            return -1;
+        }
+        p->num_workers = i + 1;   // pool_stop joins only started workers
+    }
+    return 0;
+}
+
+int pool_run(WorkPool* p, int num_chunks, PoolTask task, void* ctx) {
+    if (num_chunks > p->chunk_capacity) {
+        int* grown = (int*)realloc(p->chunk_storage, num_chunks * sizeof(int));
+        if (grown == NULL) return -1;
+        p->chunk_storage = grown;
+        p->chunk_capacity = num_chunks;
+    }
+
+    // Deal the chunks out in contiguous blocks, like a static split
+    int w = p->num_workers;
+    for (int i = 0; i < w; i++) {
+        int first = (int)((long long)i * num_chunks / w);
+        int last = (int)((long long)(i + 1) * num_chunks / w);
+        PoolDeque* d = &p->deques[i];
+        d->chunks = p->chunk_storage;
+        for (int c = first; c < last; c++) {
+            p->chunk_storage[c] = c;
+        }
+        d->head = first;
+        d->tail = last;
+    }
+    memset(p->stats, 0, w * sizeof(PoolWorkerStats));
+
+    pthread_mutex_lock(&p->lock);
+    p->task = task;
+    p->ctx = ctx;
+    p->running = w;
+    p->job++;
+    pthread_cond_broadcast(&p->job_ready);
+    while (p->running > 0) {
+        pthread_cond_wait(&p->job_done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+
+void pool_stop(WorkPool* p) {
+    pthread_mutex_lock(&p->lock);
+    p->stopping = 1;
+    pthread_cond_broadcast(&p->job_ready);
+    pthread_mutex_unlock(&p->lock);
+
+    for (int i = 0; i < p->num_workers; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+    if (p->deques != NULL) {
+        for (int i = 0; i < p->num_workers; i++) {
+            pthread_mutex_destroy(&p->deques[i].lock);
+        }
+    }
+    free(p->threads);
+    free(p->deques);
+    free(p->stats);
+    free(p->chunk_storage);
+    pthread_mutex_destroy(&p->lock);
+    pthread_cond_destroy(&p->job_ready);
+    pthread_cond_destroy(&p->job_done);
+    memset(p, 0, sizeof(*p));
+}
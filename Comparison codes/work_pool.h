@@ -0,0 +1,66 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <pthread.h>
+
+// Persistent thread pool that runs jobs split into numbered chunks, with
+// work stealing.
+//
+// The workers are created once and sleep between jobs. pool_run() deals a
+// job's chunks out in contiguous blocks, one per worker, into per-worker
+// deques. A worker takes chunks from the front of its own deque (in order,
+// for locality). When that is empty it steals from the back of the others'
+// deques, so a worker that drew expensive chunks (e.g. where a selective
+// query's matches cluster) is helped instead of finishing last. Chunks are
+// never added during a job, so a worker that finds every deque empty is
+// done.
+
+// Called once per chunk; worker is the running worker's index (0-based)
+typedef void (*PoolTask)(void* ctx, int worker, int chunk);
+
+typedef struct {
+    long long chunks;       // chunks run
+    long long stolen;       // of which taken from another worker's deque
+    double busy_seconds;    // time spent inside the task
+} PoolWorkerStats;
+
+typedef struct {
+    pthread_mutex_t lock;
+    int* chunks;            // chunk ids [head, tail) still to run
+    int head;
+    int tail;
+} PoolDeque;
+
+typedef struct {
+    int num_workers;
+    pthread_t* threads;
+    PoolDeque* deques;
+    PoolWorkerStats* stats; // for the last job
+    int* chunk_storage;     // backing array of the deques
+    int chunk_capacity;
+
+    // Current job, under lock
+    PoolTask task;
+    void* ctx;
+    unsigned long job;      // incremented by every pool_run
+    int running;            // workers that have not finished the job
+    int stopping;
+    pthread_mutex_t lock;
+    pthread_cond_t job_ready;
+    pthread_cond_t job_done;
+} WorkPool;
+
+// Start num_workers threads. If cpus is not NULL, worker i is pinned to
+// CPU cpus[i]. Returns 0, or -1 if a thread or memory could not be had
+// (the pool is then cleaned up).
+int pool_start(WorkPool* p, int num_workers, const int* cpus);
+
+// Run task(ctx, worker, chunk) for every chunk in [0, num_chunks) and wait
+// for all of them. Resets and refills p->stats. Returns 0, or -1 if out of
+// memory (nothing ran).
+int pool_run(WorkPool* p, int num_chunks, PoolTask task, void* ctx);
+
+// Stop and join the workers, free the pool
+void pool_stop(WorkPool* p);
+
+#endif
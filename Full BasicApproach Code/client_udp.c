@@ -5,8 +5,24 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/time.h>
 
 #define BUFFER_SIZE 4096
+#define MAX_DICT 256
+#define MAX_NAME 128
+#define REPLY_TIMEOUT_SEC 2
+
+// Binary responses (query with FORMAT=BIN), little-endian; see server_udp.c:
+//   header  "WHB1", u32 catalogue version, u32 matches, u32 offset,
+//           u32 records, u32 results still to fetch
+//   record  u32 row, u8 province code, u8 category code, i32 days,
+//           f64 price, f64 rating, f64 score, u8 length + package id,
+//           u8 length + place name
+#define BIN_HEADER_SIZE 24
+
+// Province / category names by code, fetched with "DICT" requests
+char province_names[MAX_DICT][MAX_NAME];
+char category_names[MAX_DICT][MAX_NAME];
 
 // If user types only digits (like "3"), treat it as TOPK=3
 int is_only_number(const char *s) {
@@ -17,6 +33,89 @@ int is_only_number(const char *s) {
     return 1;
 }
 
+unsigned int get_u32(const unsigned char* p) {
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) |
+           ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+double get_f64(const unsigned char* p) {
+    unsigned long long bits = get_u32(p) | ((unsigned long long)get_u32(p + 4) << 32);
+    double v;
+    memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Send a request and wait for its reply. Returns the reply length, or -1.
+int request(int sockfd, struct sockaddr_in* servaddr, const char* text, char* buffer) {
+    sendto(sockfd, text, strlen(text), 0, (struct sockaddr*)servaddr, sizeof(*servaddr));
+    int n = recvfrom(sockfd, buffer, BUFFER_SIZE - 1, 0, NULL, NULL);
+    if (n <= 0) return -1;
+    buffer[n] = '\0';
+    return n;
+}
+
+// Fetch the server's dictionaries (all pages). Returns their catalogue
+// version, or -1 if the server did not answer.
+long fetch_dict(int sockfd, struct sockaddr_in* servaddr) {
+    char buffer[BUFFER_SIZE];
+    char text[64] = "DICT";
+    long version = -1;
+
+    while (1) {
+        if (request(sockfd, servaddr, text, buffer) < 0) return -1;
+        int more = -1;
+        char* line = strtok(buffer, "\n");
+        while (line != NULL) {
+            int code;
+            char name[MAX_NAME];
+            if (sscanf(line, "PROVINCE %d %127[^\n]", &code, name) == 2 && code >= 0 && code < MAX_DICT) {
+                strcpy(province_names[code], name);
+            } else if (sscanf(line, "CATEGORY %d %127[^\n]", &code, name) == 2 && code >= 0 && code < MAX_DICT) {
+                strcpy(category_names[code], name);
+            } else if (strncmp(line, "MORE OFFSET=", 12) == 0) {
+                more = atoi(line + 12);
+            } else {
+                sscanf(line, "DICT version=%ld", &version);
+            }
+            line = strtok(NULL, "\n");
+        }
+        if (more < 0) return version;
+        snprintf(text, sizeof(text), "DICT;OFFSET=%d", more);
+    }
+}
+
+// Print the records of one binary page; returns how many there were
+int print_binary_page(const unsigned char* p, int n) {
+    unsigned int records = get_u32(p + 16);
+    unsigned int rank = get_u32(p + 12);
+    const unsigned char* end = p + n;
+    p += BIN_HEADER_SIZE;
+
+    for (unsigned int i = 0; i < records; i++) {
+        if (p + 34 > end) break;
+        int province = p[4];
+        int category = p[5];
+        int days = (int)get_u32(p + 6);
+        double price = get_f64(p + 10);
+        double rating = get_f64(p + 18);
+        double score = get_f64(p + 26);
+        p += 34;
+        int id_len = *p++;
+        const unsigned char* id = p;
+        p += id_len;
+        int name_len = *p++;
+        const unsigned char* name = p;
+        p += name_len;
+        if (p > end) break;
+
+        printf("%u. %.*s | %.*s, %s | Category: %s | Days: %d | Price: %.0f | Rating: %.1f | Score: %.2f\n",
+               rank + i + 1, id_len, (const char*)id, name_len, (const char*)name,
+               province_names[province], category_names[category],
+               days, price, rating, score);
+    }
+    return (int)records;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         printf("Usage: %s <server_port> [server_ip]\n", argv[0]);
@@ -78,20 +177,66 @@ int main(int argc, char* argv[]) {
 
     printf("\nSending query to %s:%d\nQuery: %s\n\n", server_ip, server_port, query);
 
-    // Send query
-    sendto(sockfd, query, strlen(query), 0, (struct sockaddr*)&servaddr, sizeof(servaddr));
+    struct timeval tv = { REPLY_TIMEOUT_SEC, 0 };
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
 
-    // Receive response
+    // Send the query, then ask for the next page while the server reports
+    // results that did not fit in one datagram
     char buffer[BUFFER_SIZE];
-    socklen_t len = sizeof(servaddr);
-    int n = recvfrom(sockfd, buffer, BUFFER_SIZE - 1, 0, (struct sockaddr*)&servaddr, &len);
-
-    if (n > 0) {
-        buffer[n] = '\0';
-        printf("==== Server Response ====\n%s", buffer);
-    } else {
-        printf("No response received.\n");
+    char page_query[sizeof(query) + 64];
+    strcpy(page_query, query);
+    long dict_version = -1;
+    int total_bytes = 0;
+    int datagrams = 0;
+    int retries = 0;
+
+    while (1) {
+        int n = request(sockfd, &servaddr, page_query, buffer);
+        if (n < 0) {
+            printf("No response received.\n");
+            break;
+        }
+        total_bytes += n;
+        datagrams++;
+
+        if (n >= BIN_HEADER_SIZE && memcmp(buffer, "WHB1", 4) == 0) {
+            const unsigned char* p = (const unsigned char*)buffer;
+            long version = (long)get_u32(p + 4);
+            unsigned int offset = get_u32(p + 12);
+            unsigned int records = get_u32(p + 16);
+            unsigned int remaining = get_u32(p + 20);
+
+            // Names come from the dictionaries of the same catalogue version
+            if (version != dict_version) {
+                dict_version = fetch_dict(sockfd, &servaddr);
+                if (dict_version != version && retries++ < 3) continue;
+            }
+            if (datagrams == 1 || offset == 0) {
+                printf("==== Server Response ====\n");
+                if (get_u32(p + 8) == 0) printf("No packages match the query filters.\n");
+                else printf("FOUND %u matching packages. TOP %u:\n", get_u32(p + 8), records + remaining);
+            }
+            print_binary_page(p, n);
+
+            if (remaining == 0 || records == 0) break;
+            snprintf(page_query, sizeof(page_query), "%s;OFFSET=%u;TOPK=%u", query, offset + records, remaining);
+        } else {
+            // Text: print everything but the MORE line; later pages repeat
+            // the FOUND line, so skip it there
+            char* body = buffer;
+            if (datagrams == 1) printf("==== Server Response ====\n");
+            else if (strncmp(body, "FOUND ", 6) == 0 && strchr(body, '\n') != NULL) body = strchr(body, '\n') + 1;
+
+            int offset = -1, topk = 0;
+            char* more = strstr(body, "MORE OFFSET=");
+            if (more != NULL && sscanf(more, "MORE OFFSET=%d TOPK=%d", &offset, &topk) == 2) *more = '\0';
+            printf("%s", body);
+
+            if (offset < 0) break;
+            snprintf(page_query, sizeof(page_query), "%s;OFFSET=%d;TOPK=%d", query, offset, topk);
+        }
     }
+    if (datagrams > 1) printf("(%d bytes in %d datagrams)\n", total_bytes, datagrams);
 
     close(sockfd);
     return 0;